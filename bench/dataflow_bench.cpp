@@ -0,0 +1,206 @@
+// Scaling benchmark for the bit-vector dataflow analyses.
+//
+// Generates Vypr functions of growing size (branches, loops and assignments
+// over a fixed pool of variables), lowers them to IR and times the CFG
+// construction plus each analysis. A growth exponent near 1 means the cost
+// per instruction stays flat as functions get larger.
+#include "lexer.h"
+#include "parser.h"
+#include "semantic_analyzer.h"
+#include "ir_generator.h"
+#include "dataflow.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace vypr;
+
+namespace {
+
+struct BenchOptions {
+    size_t maxChunks = 16000;  // Statements groups in the largest function
+    size_t variables = 32;     // Size of the variable pool
+    int runs = 3;              // Timings keep the fastest run
+};
+
+// One function named "big" made of `chunks` randomly chosen statement groups
+std::string generateProgram(size_t chunks, size_t variables, unsigned seed) {
+    std::mt19937 rng(seed);
+    auto pick = [&]() { return "v" + std::to_string(rng() % variables); };
+
+    std::ostringstream out;
+    out << "func big(a, b):\n";
+    for (size_t v = 0; v < variables; ++v) {
+        out << "    var v" << v << " = a + " << v << "\n";
+    }
+    for (size_t c = 0; c < chunks; ++c) {
+        std::string x = pick(), y = pick(), z = pick();
+        switch (rng() % 4) {
+            case 0:
+                out << "    if " << x << " > " << y << ":\n";
+                out << "        " << x << " = " << x << " + " << y << " * 3\n";
+                out << "    else:\n";
+                out << "        " << y << " = " << x << " + " << y << " * 3\n";
+                break;
+            case 1:
+                out << "    while " << x << " < b:\n";
+                out << "        " << x << " = " << x << " + 1\n";
+                out << "        " << z << " = " << z << " - " << y << "\n";
+                break;
+            case 2:
+                out << "    " << x << " = " << y << " + " << z << "\n";
+                out << "    " << z << " = " << y << " + " << z << "\n";
+                break;
+            case 3:
+                out << "    loop 2 times:\n";
+                out << "        " << y << " = " << y << " % 7\n";
+                break;
+        }
+    }
+    out << "    return v0\n\n";
+    out << "print big(1, 2)\n";
+    return out.str();
+}
+
+IRFunction lower(const std::string& source) {
+    Lexer lexer(source);
+    std::vector<Token> tokens = lexer.tokenize();
+    Parser parser(tokens, false);
+    std::shared_ptr<Program> ast = parser.parse();
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(ast);
+    IRGenerator irGen;
+    for (auto& function : irGen.generate(ast)) {
+        if (function.name == "big") {
+            return function;
+        }
+    }
+    throw std::runtime_error("generated program has no function 'big'");
+}
+
+// Fastest of `runs` runs, in seconds
+double timeIt(int runs, const std::function<void()>& work) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// Least-squares slope of log(time) over log(instructions)
+double growthExponent(const std::vector<std::pair<double, double>>& samples) {
+    double n = static_cast<double>(samples.size());
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const auto& [size, seconds] : samples) {
+        double x = std::log(size);
+        double y = std::log(seconds);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denominator = n * sxx - sx * sx;
+    return denominator == 0 ? 0.0 : (n * sxy - sx * sy) / denominator;
+}
+
+void printUsage() {
+    std::cout << "Usage: vypr_dataflow_bench [options]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  -n <chunks>     Statement groups in the largest function (default 16000)\n";
+    std::cout << "  -v <variables>  Variables the statements draw from (default 32)\n";
+    std::cout << "  -r <runs>       Runs per measurement, the fastest is kept (default 3)\n";
+    std::cout << "  -h, --help      Show this help message\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-n" || arg == "-v" || arg == "-r") && i + 1 < argc) {
+            long value = std::atol(argv[++i]);
+            if (value <= 0) {
+                std::cerr << "Error: " << arg << " needs a positive number\n";
+                return 1;
+            }
+            if (arg == "-n") options.maxChunks = static_cast<size_t>(value);
+            if (arg == "-v") options.variables = static_cast<size_t>(value);
+            if (arg == "-r") options.runs = static_cast<int>(value);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown option '" << arg << "'\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    struct Analysis {
+        const char* name;
+        std::function<DataflowFacts(const ControlFlowGraph&)> run;
+        std::vector<std::pair<double, double>> samples;
+    };
+    std::vector<Analysis> analyses = {
+        {"liveness", computeLiveness, {}},
+        {"reaching-definitions", computeReachingDefinitions, {}},
+        {"available-expressions", computeAvailableExpressions, {}},
+        {"definite-initialization", computeDefiniteInitialization, {}},
+    };
+    std::vector<std::pair<double, double>> cfgSamples;
+
+    std::cout << std::left << std::setw(24) << "analysis" << std::right << std::setw(10) << "instrs"
+              << std::setw(8) << "blocks" << std::setw(8) << "domain" << std::setw(9) << "visits"
+              << std::setw(11) << "ms" << std::setw(11) << "ns/instr" << "\n";
+
+    for (size_t chunks = std::max<size_t>(options.maxChunks >> 5, 1); chunks <= options.maxChunks; chunks *= 2) {
+        std::vector<IRFunction> lowered;
+        try {
+            lowered.push_back(lower(generateProgram(chunks, options.variables, 1)));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        const IRFunction& function = lowered.front();
+        double instructions = static_cast<double>(function.instructions.size());
+
+        double cfgSeconds = timeIt(options.runs, [&]() { ControlFlowGraph cfg(function); });
+        ControlFlowGraph cfg(function);
+        cfgSamples.push_back({instructions, cfgSeconds});
+        std::cout << std::left << std::setw(24) << "cfg" << std::right << std::setw(10) << function.instructions.size()
+                  << std::setw(8) << cfg.blocks().size() << std::setw(8) << "-" << std::setw(9) << "-"
+                  << std::setw(11) << std::fixed << std::setprecision(3) << cfgSeconds * 1e3 << std::setw(11)
+                  << std::setprecision(1) << cfgSeconds * 1e9 / instructions << "\n";
+
+        for (auto& analysis : analyses) {
+            DataflowFacts facts;
+            double seconds = timeIt(options.runs, [&]() { facts = analysis.run(cfg); });
+            analysis.samples.push_back({instructions, seconds});
+            std::cout << std::left << std::setw(24) << analysis.name << std::right << std::setw(10)
+                      << function.instructions.size() << std::setw(8) << cfg.blocks().size() << std::setw(8)
+                      << facts.domain.size() << std::setw(9) << facts.result.visits << std::setw(11)
+                      << std::setprecision(3) << seconds * 1e3 << std::setw(11) << std::setprecision(1)
+                      << seconds * 1e9 / instructions << "\n";
+        }
+    }
+
+    std::cout << "\nGrowth exponents (1.0 = linear):\n";
+    std::cout << "  " << std::left << std::setw(24) << "cfg" << std::setprecision(2) << growthExponent(cfgSamples) << "\n";
+    for (const auto& analysis : analyses) {
+        std::cout << "  " << std::left << std::setw(24) << analysis.name << std::setprecision(2)
+                  << growthExponent(analysis.samples) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,964 @@
+// Performance-pathology fuzzer for the Vypr compiler.
+//
+// Mutates Vypr programs with grammar-aware mutations and keeps the mutants
+// that maximize compile time or output size per input byte. Interesting
+// mutants are grown k-fold to check how every stage scales; inputs on which
+// a stage grows super-linearly are minimized and saved with a report.
+#include "lexer.h"
+#include "parser.h"
+#include "semantic_analyzer.h"
+#include "ir_generator.h"
+#include "ir_optimizer.h"
+#include "code_generator.h"
+#include "pyext_generator.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace vypr;
+
+namespace {
+
+using Lines = std::vector<std::string>;
+
+// Compiler stages whose cost is measured
+enum Stage { LEX, PARSE, SEMANTIC, IR, OPTIMIZE, PYTHON, PYEXT, STAGE_COUNT };
+const char* const stageNames[STAGE_COUNT] = {"lex", "parse", "semantic", "ir", "optimize", "python", "pyext"};
+
+// Cost of compiling one input
+struct Measurement {
+    bool valid = false;
+    double seconds[STAGE_COUNT] = {};
+    size_t outputSize[STAGE_COUNT] = {};  // Tokens, IR instructions or generated bytes (0 if none)
+};
+
+// A stage whose time or output size grows super-linearly with the input
+struct Finding {
+    Stage stage;
+    bool time;                                       // Compile time, otherwise output size
+    double exponent;                                 // Fitted growth exponent
+    std::vector<std::pair<size_t, double>> samples;  // (Input bytes, seconds or size)
+};
+
+struct FuzzOptions {
+    int iterations = 2000;
+    unsigned seed = 1;
+    std::string outputDir = "perf_findings";
+    size_t maxInputBytes = 16 * 1024;
+    int maxScale = 16;             // Largest growth factor of the scaling check
+    int repeats = 5;               // Timing runs per scaled input (the fastest counts)
+    double timeExponent = 1.5;     // Time must grow faster than bytes^timeExponent
+    double sizeExponent = 1.2;     // Output must grow faster than bytes^sizeExponent
+    double minSeconds = 0.002;     // Ignore stages faster than this on the largest input
+    int minimizeAttempts = 150;
+};
+
+// Line helpers. Programs are handled as lines so mutations can respect the
+// indentation-based block structure.
+
+int indentOf(const std::string& line) {
+    int indent = 0;
+    while (indent < static_cast<int>(line.size()) && line[indent] == ' ') {
+        indent++;
+    }
+    return indent;
+}
+
+std::string trimmed(const std::string& line) {
+    return line.substr(indentOf(line));
+}
+
+bool startsWith(const std::string& text, const std::string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Split source into lines, dropping blank and comment-only lines
+Lines splitLines(const std::string& source) {
+    Lines lines;
+    std::istringstream stream(source);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::string text = trimmed(line);
+        if (!text.empty() && !startsWith(text, "//")) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+std::string joinLines(const Lines& lines) {
+    std::string source;
+    for (const auto& line : lines) {
+        source += line + "\n";
+    }
+    return source;
+}
+
+// One past the last line of the statement starting at `start`, including its
+// nested block and any else branches
+size_t blockEnd(const Lines& lines, size_t start) {
+    int indent = indentOf(lines[start]);
+    size_t end = start + 1;
+    while (end < lines.size()) {
+        int lineIndent = indentOf(lines[end]);
+        if (lineIndent > indent || (lineIndent == indent && startsWith(trimmed(lines[end]), "else"))) {
+            end++;
+        } else {
+            break;
+        }
+    }
+    return end;
+}
+
+// Names declared by `var` and `loop x in` statements in [begin, end)
+std::set<std::string> declaredNames(const Lines& lines, size_t begin, size_t end) {
+    std::set<std::string> names;
+    auto readNames = [&](const std::string& text, size_t pos, char stop) {
+        std::string name;
+        for (; pos <= text.size(); ++pos) {
+            char c = pos < text.size() ? text[pos] : stop;
+            if (isIdentifierChar(c)) {
+                name += c;
+            } else if (c == ',' || c == ' ' || c == stop) {
+                if (!name.empty()) {
+                    names.insert(name);
+                    name.clear();
+                }
+                if (c == stop) {
+                    break;
+                }
+            } else {
+                break;
+            }
+        }
+    };
+    for (size_t i = begin; i < end; ++i) {
+        std::string text = trimmed(lines[i]);
+        if (startsWith(text, "var ")) {
+            readNames(text, 4, '=');
+        } else if (startsWith(text, "loop ") && text.find(" in ") != std::string::npos) {
+            names.insert(text.substr(5, text.find(" in ") - 5));
+        }
+    }
+    return names;
+}
+
+// Append `suffix` to every identifier of `line` found in `names`, leaving
+// string literals, comments and member names alone
+std::string renameIdentifiers(const std::string& line, const std::set<std::string>& names, const std::string& suffix) {
+    std::string result;
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (c == '"') {
+            size_t end = i + 1;
+            while (end < line.size() && line[end] != '"') {
+                end += line[end] == '\\' ? 2 : 1;
+            }
+            end = std::min(end + 1, line.size());
+            result += line.substr(i, end - i);
+            i = end;
+        } else if (c == '/' && i + 1 < line.size() && line[i + 1] == '/') {
+            result += line.substr(i);
+            break;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t end = i;
+            while (end < line.size() && isIdentifierChar(line[end])) {
+                end++;
+            }
+            std::string word = line.substr(i, end - i);
+            bool member = i > 0 && line[i - 1] == '.';
+            result += word + (!member && names.count(word) ? suffix : "");
+            i = end;
+        } else {
+            result += c;
+            i++;
+        }
+    }
+    return result;
+}
+
+// Copy [begin, end) shifted so that its first line sits at `indent`
+Lines reindent(const Lines& lines, size_t begin, size_t end, int indent) {
+    Lines block;
+    int shift = indent - indentOf(lines[begin]);
+    for (size_t i = begin; i < end; ++i) {
+        int lineIndent = std::max(0, indentOf(lines[i]) + shift);
+        block.push_back(std::string(lineIndent, ' ') + trimmed(lines[i]));
+    }
+    return block;
+}
+
+// Grow a program k-fold: every function body and every top-level statement
+// is repeated k times, with the names it declares renamed per copy so that
+// the copies stay independent
+std::string scaleProgram(const Lines& lines, int k) {
+    std::set<std::string> globals;
+    for (size_t i = 0; i < lines.size(); i = blockEnd(lines, i)) {
+        if (!startsWith(trimmed(lines[i]), "func ")) {
+            auto names = declaredNames(lines, i, blockEnd(lines, i));
+            globals.insert(names.begin(), names.end());
+        }
+    }
+
+    Lines scaled;
+    for (size_t i = 0; i < lines.size();) {
+        size_t end = blockEnd(lines, i);
+        bool function = startsWith(trimmed(lines[i]), "func ");
+        size_t bodyBegin = function ? i + 1 : i;
+        auto names = function ? declaredNames(lines, bodyBegin, end) : globals;
+
+        if (function) {
+            scaled.push_back(lines[i]);
+        }
+        for (int copy = 0; copy < k; ++copy) {
+            for (size_t j = bodyBegin; j < end; ++j) {
+                scaled.push_back(copy == 0 ? lines[j] : renameIdentifiers(lines[j], names, "_k" + std::to_string(copy)));
+            }
+        }
+        i = end;
+    }
+    return joinLines(scaled);
+}
+
+// Least-squares slope of log(y) over log(x)
+double logLogSlope(const std::vector<std::pair<double, double>>& points) {
+    double n = static_cast<double>(points.size());
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const auto& [x, y] : points) {
+        sx += std::log(x);
+        sy += std::log(y);
+        sxx += std::log(x) * std::log(x);
+        sxy += std::log(x) * std::log(y);
+    }
+    double denominator = n * sxx - sx * sx;
+    return denominator > 0 ? (n * sxy - sx * sy) / denominator : 0.0;
+}
+
+// Exponent p of value ~ bytes^p. It is fitted on the marginal cost of each
+// added byte, which grows like bytes^(p-1), so that fixed costs such as
+// function headers or the generated runtime prologue do not look like growth.
+// Returns 0 when there are not enough increasing samples.
+double growthExponent(const std::vector<std::pair<size_t, double>>& samples) {
+    std::vector<std::pair<double, double>> marginal;
+    for (size_t i = 1; i < samples.size(); ++i) {
+        double bytes = static_cast<double>(samples[i].first) - static_cast<double>(samples[i - 1].first);
+        double value = samples[i].second - samples[i - 1].second;
+        if (bytes > 0 && value > 0) {
+            marginal.push_back({static_cast<double>(samples[i].first), value / bytes});
+        }
+    }
+    return marginal.size() >= 2 ? 1.0 + logLogSlope(marginal) : 0.0;
+}
+
+// Exponent p of time ~ bytes^p, fitted on all but the smallest input, whose
+// time is mostly fixed costs and timer noise. Returns 0 unless every step
+// between the remaining inputs grows faster than bytes^threshold as well, so
+// a single noisy timing cannot make a linear stage look super-linear.
+double timeGrowthExponent(const std::vector<std::pair<size_t, double>>& samples, double threshold) {
+    if (samples.size() < 4) {
+        return 0.0;
+    }
+    std::vector<std::pair<double, double>> points;
+    for (size_t i = 1; i < samples.size(); ++i) {
+        double bytes = static_cast<double>(samples[i].first);
+        if (i > 1) {
+            double step = std::log(samples[i].second / samples[i - 1].second) /
+                          std::log(bytes / static_cast<double>(samples[i - 1].first));
+            if (!(step > threshold)) {
+                return 0.0;
+            }
+        }
+        points.push_back({bytes, samples[i].second});
+    }
+    return logLogSlope(points);
+}
+
+class PerfFuzzer {
+public:
+    explicit PerfFuzzer(const FuzzOptions& options)
+        : options(options), rng(options.seed) {
+        auto scratch = std::filesystem::temp_directory_path() / ("vypr_perf_fuzz_" + std::to_string(options.seed));
+        pythonFile = scratch.string() + ".py";
+        extensionFile = scratch.string() + ".c";
+    }
+
+    ~PerfFuzzer() {
+        std::error_code ignored;
+        std::filesystem::remove(pythonFile, ignored);
+        std::filesystem::remove(extensionFile, ignored);
+    }
+
+    // Add a seed program, returns false if it does not compile
+    bool addSeed(const std::string& source) {
+        Lines lines = splitLines(source);
+        Measurement m = measure(joinLines(lines));
+        if (!m.valid) {
+            return false;
+        }
+        corpus.push_back(lines);
+        seeds++;
+        isInteresting(m, joinLines(lines).size());
+        return true;
+    }
+
+    void run() {
+        int invalid = 0;
+        for (int iteration = 1; iteration <= options.iterations; ++iteration) {
+            Lines mutant = corpus[pick(corpus.size())];
+            int mutations = 1 + static_cast<int>(pick(4));
+            for (int i = 0; i < mutations; ++i) {
+                mutant = mutate(mutant);
+            }
+
+            std::string source = joinLines(mutant);
+            if (mutant.empty() || source.size() > options.maxInputBytes ||
+                !seen.insert(std::hash<std::string>()(source)).second) {
+                continue;
+            }
+
+            Measurement m = measure(source);
+            if (!m.valid) {
+                invalid++;
+            } else if (isInteresting(m, source.size())) {
+                addToCorpus(mutant);
+                for (const auto& finding : checkScaling(mutant)) {
+                    report(mutant, finding);
+                }
+            }
+
+            if (iteration % 100 == 0) {
+                std::cout << "#" << iteration << " corpus: " << corpus.size() << " invalid: " << invalid
+                          << " findings: " << saved << "\n";
+            }
+        }
+        std::cout << "Done: " << saved << " finding(s) saved to " << options.outputDir << "\n";
+    }
+
+private:
+    FuzzOptions options;
+    std::mt19937 rng;
+    std::vector<Lines> corpus;
+    size_t seeds = 0;
+    std::unordered_set<size_t> seen;
+    double best[2 * STAGE_COUNT] = {};        // Best time and size per input byte of every stage
+    std::map<std::pair<int, bool>, double> reported;  // Exponent already saved per (stage, time)
+    int saved = 0;
+    int nextId = 0;
+    std::string pythonFile;
+    std::string extensionFile;
+
+    size_t pick(size_t count) {
+        return std::uniform_int_distribution<size_t>(0, count - 1)(rng);
+    }
+
+    // Run every stage of the compiler on `source` and record its cost
+    Measurement measure(const std::string& source) const {
+        using Clock = std::chrono::steady_clock;
+        Measurement m;
+        auto start = Clock::now();
+        auto lap = [&](Stage stage) {
+            auto now = Clock::now();
+            m.seconds[stage] = std::chrono::duration<double>(now - start).count();
+            start = now;
+        };
+        auto instructionCount = [](const std::vector<IRFunction>& functions) {
+            size_t count = 0;
+            for (const auto& function : functions) {
+                count += function.instructions.size();
+            }
+            return count;
+        };
+
+        try {
+            Lexer lexer(source);
+            std::vector<Token> tokens = lexer.tokenize();
+            m.outputSize[LEX] = tokens.size();
+            lap(LEX);
+
+            Parser parser(tokens, false);
+            std::shared_ptr<Program> ast = parser.parse();
+            lap(PARSE);
+
+            SemanticAnalyzer analyzer;
+            analyzer.analyze(ast);
+            lap(SEMANTIC);
+
+            IRGenerator irGen;
+            std::vector<IRFunction> functions = irGen.generate(ast);
+            m.outputSize[IR] = instructionCount(functions);
+            lap(IR);
+
+            IROptimizer optimizer;
+            optimizer.optimize(functions);
+            m.outputSize[OPTIMIZE] = instructionCount(functions);
+            lap(OPTIMIZE);
+
+            CodeGenerator codeGen;
+            codeGen.generate(functions, pythonFile);
+            m.outputSize[PYTHON] = std::filesystem::file_size(pythonFile);
+            lap(PYTHON);
+
+            PyExtGenerator extGen;
+            extGen.generate(functions, "vypr_fuzz", extensionFile);
+            m.outputSize[PYEXT] = std::filesystem::file_size(extensionFile);
+            lap(PYEXT);
+
+            m.valid = true;
+        } catch (const std::exception&) {
+            // Invalid mutants are expected, they are simply discarded
+        }
+        return m;
+    }
+
+    // Fastest of several runs, to keep timer noise out of the scaling fit
+    Measurement measureBest(const std::string& source) const {
+        Measurement result = measure(source);
+        for (int run = 1; run < options.repeats && result.valid; ++run) {
+            Measurement m = measure(source);
+            for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+                result.seconds[stage] = std::min(result.seconds[stage], m.seconds[stage]);
+            }
+        }
+        return result;
+    }
+
+    // True if the input sets a new maximum of time or output per input byte
+    // in some stage
+    bool isInteresting(const Measurement& m, size_t bytes) {
+        bool interesting = false;
+        for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+            double perByte[2] = {m.seconds[stage] / bytes, static_cast<double>(m.outputSize[stage]) / bytes};
+            for (int metric = 0; metric < 2; ++metric) {
+                double& record = best[2 * stage + metric];
+                if (perByte[metric] > record * 1.05) {
+                    record = perByte[metric];
+                    interesting = true;
+                }
+            }
+        }
+        return interesting;
+    }
+
+    void addToCorpus(const Lines& lines) {
+        const size_t maxCorpus = 512;
+        if (corpus.size() >= maxCorpus) {
+            // Seeds always stay, the oldest mutant makes room
+            corpus.erase(corpus.begin() + seeds);
+        }
+        corpus.push_back(lines);
+    }
+
+    // Compile the program grown 1, 2, 4, ... times and fit how each stage's
+    // time and output size grow with the input
+    std::vector<Finding> checkScaling(const Lines& lines) const {
+        std::vector<std::pair<size_t, Measurement>> runs;
+        for (int k = 1; k <= options.maxScale; k *= 2) {
+            std::string source = scaleProgram(lines, k);
+            if (source.size() > options.maxInputBytes * options.maxScale) {
+                break;
+            }
+            Measurement m = measureBest(source);
+            if (!m.valid) {
+                return {};
+            }
+            runs.push_back({source.size(), m});
+        }
+        if (runs.size() < 3 || runs.back().first < 2 * runs.front().first) {
+            return {};
+        }
+
+        std::vector<Finding> findings;
+        for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+            Finding time{static_cast<Stage>(stage), true, 0.0, {}};
+            Finding size{static_cast<Stage>(stage), false, 0.0, {}};
+            for (const auto& [bytes, m] : runs) {
+                // Sub-20us timings are mostly timer noise
+                if (m.seconds[stage] >= 20e-6) {
+                    time.samples.push_back({bytes, m.seconds[stage]});
+                }
+                if (m.outputSize[stage] > 0) {
+                    size.samples.push_back({bytes, static_cast<double>(m.outputSize[stage])});
+                }
+            }
+
+            if (!time.samples.empty() && time.samples.back().second >= options.minSeconds) {
+                time.exponent = timeGrowthExponent(time.samples, options.timeExponent);
+                if (time.exponent > options.timeExponent) {
+                    findings.push_back(time);
+                }
+            }
+            if (size.samples.size() >= 3) {
+                size.exponent = growthExponent(size.samples);
+                if (size.exponent > options.sizeExponent) {
+                    findings.push_back(size);
+                }
+            }
+        }
+        return findings;
+    }
+
+    bool stillShows(const Lines& lines, const Finding& finding) const {
+        for (const auto& other : checkScaling(lines)) {
+            if (other.stage == finding.stage && other.time == finding.time) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Greedily drop statements while the stage keeps scaling super-linearly
+    Lines minimize(Lines lines, const Finding& finding) const {
+        int attempts = 0;
+        bool progress = true;
+        while (progress && attempts < options.minimizeAttempts) {
+            progress = false;
+            for (size_t i = 0; i < lines.size() && attempts < options.minimizeAttempts;) {
+                Lines candidate(lines.begin(), lines.begin() + i);
+                candidate.insert(candidate.end(), lines.begin() + blockEnd(lines, i), lines.end());
+                attempts++;
+                if (!candidate.empty() && stillShows(candidate, finding)) {
+                    lines = candidate;
+                    progress = true;
+                } else {
+                    i++;
+                }
+            }
+        }
+        return lines;
+    }
+
+    void report(const Lines& lines, const Finding& finding) {
+        auto key = std::make_pair(static_cast<int>(finding.stage), finding.time);
+        auto it = reported.find(key);
+        if (it != reported.end() && finding.exponent < it->second + 0.25) {
+            return;
+        }
+        reported[key] = finding.exponent;
+
+        std::string metric = finding.time ? "time" : "size";
+        std::cout << "Super-linear " << metric << " in stage '" << stageNames[finding.stage]
+                  << "' (exponent " << std::fixed << std::setprecision(2) << finding.exponent
+                  << "), minimizing...\n" << std::defaultfloat;
+
+        Lines minimized = minimize(lines, finding);
+        Finding result = finding;
+        bool reproduced = false;
+        for (const auto& other : checkScaling(minimized)) {
+            if (other.stage == finding.stage && other.time == finding.time) {
+                result = other;
+                reproduced = true;
+            }
+        }
+        if (!reproduced) {
+            // Timing noise let the minimizer go too far, keep the original
+            minimized = lines;
+        }
+
+        std::string source = joinLines(minimized);
+        std::ostringstream name;
+        name << stageNames[finding.stage] << "-" << metric << "-" << std::hex << std::hash<std::string>()(source);
+        std::filesystem::path base = std::filesystem::path(options.outputDir) / name.str();
+        std::filesystem::create_directories(options.outputDir);
+
+        std::ofstream program(base.string() + ".vy");
+        program << source;
+
+        std::ofstream details(base.string() + ".txt");
+        details << "stage: " << stageNames[finding.stage] << "\n";
+        details << "metric: " << (finding.time ? "compile time (s)" : "output size") << "\n";
+        details << "exponent: " << result.exponent << "\n";
+        details << "scaling (input bytes -> value):\n";
+        for (const auto& [bytes, value] : result.samples) {
+            details << "  " << bytes << " -> " << value << "\n";
+        }
+
+        saved++;
+        std::cout << "Saved " << base.string() << ".vy (" << source.size() << " bytes)\n";
+    }
+
+    // Grammar-aware mutations
+
+    Lines mutate(const Lines& lines) {
+        switch (pick(9)) {
+            case 0: return duplicateStatement(lines);
+            case 1: return wrapInControl(lines);
+            case 2: return insertElseIfChain(lines);
+            case 3: return growExpression(lines);
+            case 4: return insertArrayLiteral(lines);
+            case 5: return insertFunction(lines);
+            case 6: return cloneFunction(lines);
+            case 7: return spliceFrom(lines, corpus[pick(corpus.size())]);
+            default: return deleteStatement(lines);
+        }
+    }
+
+    std::string freshName(const std::string& prefix) {
+        return prefix + std::to_string(nextId++);
+    }
+
+    // Random statement that starts a block (never an else branch)
+    bool pickStatement(const Lines& lines, size_t& start) {
+        if (lines.empty()) {
+            return false;
+        }
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            start = pick(lines.size());
+            if (!startsWith(trimmed(lines[start]), "else")) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Random position a new statement can be inserted at, and its indentation
+    size_t pickInsertion(const Lines& lines, bool topLevel, int& indent) {
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            size_t at = pick(lines.size() + 1);
+            if (at == lines.size()) {
+                indent = 0;
+                return at;
+            }
+            indent = indentOf(lines[at]);
+            if (!startsWith(trimmed(lines[at]), "else") && (!topLevel || indent == 0)) {
+                return at;
+            }
+        }
+        indent = 0;
+        return lines.size();
+    }
+
+    Lines insertAt(const Lines& lines, size_t at, const Lines& block) {
+        Lines result(lines.begin(), lines.begin() + at);
+        result.insert(result.end(), block.begin(), block.end());
+        result.insert(result.end(), lines.begin() + at, lines.end());
+        return result;
+    }
+
+    // Repeat a statement right after itself, renaming what it declares
+    Lines duplicateStatement(const Lines& lines) {
+        size_t start;
+        if (!pickStatement(lines, start)) {
+            return lines;
+        }
+        size_t end = blockEnd(lines, start);
+        auto names = declaredNames(lines, start, end);
+        std::string suffix = freshName("_d");
+        Lines copy;
+        for (size_t i = start; i < end; ++i) {
+            copy.push_back(renameIdentifiers(lines[i], names, suffix));
+        }
+        if (startsWith(trimmed(lines[start]), "func ")) {
+            std::string header = trimmed(copy[0]);
+            size_t paren = header.find('(');
+            if (paren == std::string::npos) {
+                return lines;
+            }
+            copy[0] = "func " + freshName("fd") + header.substr(paren);
+        }
+        return insertAt(lines, end, copy);
+    }
+
+    // Nest a statement inside a new if, while or loop block
+    Lines wrapInControl(const Lines& lines) {
+        static const char* const headers[] = {"if true:", "if 1 < 2:", "while false:", "loop 2 times:", "if false:"};
+        size_t start;
+        if (!pickStatement(lines, start) || startsWith(trimmed(lines[start]), "func ")) {
+            return lines;
+        }
+        size_t end = blockEnd(lines, start);
+        int indent = indentOf(lines[start]);
+        Lines block = {std::string(indent, ' ') + headers[pick(5)]};
+        Lines body = reindent(lines, start, end, indent + 4);
+        block.insert(block.end(), body.begin(), body.end());
+
+        Lines result(lines.begin(), lines.begin() + start);
+        result.insert(result.end(), block.begin(), block.end());
+        result.insert(result.end(), lines.begin() + end, lines.end());
+        return result;
+    }
+
+    // Insert `if n == 0: ... else if n == 1: ... else: ...`
+    Lines insertElseIfChain(const Lines& lines) {
+        int indent;
+        size_t at = pickInsertion(lines, false, indent);
+        std::string pad(indent, ' ');
+        std::string value = std::to_string(pick(32));
+        size_t branches = 2 + pick(31);
+
+        Lines chain;
+        for (size_t b = 0; b < branches; ++b) {
+            chain.push_back(pad + (b == 0 ? "if " : "else if ") + value + " == " + std::to_string(b) + ":");
+            chain.push_back(pad + "    print " + std::to_string(b));
+        }
+        chain.push_back(pad + "else:");
+        chain.push_back(pad + "    print " + value);
+        return insertAt(lines, at, chain);
+    }
+
+    // Replace an integer literal or condition with a larger equivalent one
+    Lines growExpression(const Lines& lines) {
+        if (lines.empty()) {
+            return lines;
+        }
+        Lines result = lines;
+        size_t index = pick(lines.size());
+        std::string& line = result[index];
+        std::string text = trimmed(line);
+
+        if ((startsWith(text, "if ") || startsWith(text, "while ") || startsWith(text, "else if ")) &&
+            text.back() == ':' && pick(2) == 0) {
+            size_t begin = startsWith(text, "else if ") ? 8 : text.find(' ') + 1;
+            std::string condition = text.substr(begin, text.size() - begin - 1);
+            const char* const extra[] = {" && (1 < 2)", " || (1 > 2)", " && !(1 > 2)"};
+            line = std::string(indentOf(line), ' ') + text.substr(0, begin) + "(" + condition + ")" +
+                   extra[pick(3)] + ":";
+            return result;
+        }
+
+        // Find integer literals outside strings and comments
+        std::vector<std::pair<size_t, size_t>> literals;
+        for (size_t i = 0; i < line.size();) {
+            if (line[i] == '"') {
+                i++;
+                while (i < line.size() && line[i] != '"') {
+                    i += line[i] == '\\' ? 2 : 1;
+                }
+                i++;
+            } else if (line.compare(i, 2, "//") == 0) {
+                break;
+            } else if (std::isdigit(static_cast<unsigned char>(line[i])) && (i == 0 || !isIdentifierChar(line[i - 1]))) {
+                size_t end = i;
+                while (end < line.size() && (isIdentifierChar(line[end]) || line[end] == '.')) {
+                    end++;
+                }
+                literals.push_back({i, end});
+                i = end;
+            } else {
+                i++;
+            }
+        }
+        if (literals.empty()) {
+            return lines;
+        }
+
+        auto [begin, end] = literals[pick(literals.size())];
+        std::string n = line.substr(begin, end - begin);
+        const std::string grown[] = {"(" + n + " + " + n + " * 2)", "(" + n + " * (" + n + " - 1))",
+                                     "(" + n + " % 7 + " + n + ")", "((" + n + " + 1) - 1)"};
+        line = line.substr(0, begin) + grown[pick(4)] + line.substr(end);
+        return result;
+    }
+
+    // Insert a wide array literal and index it
+    Lines insertArrayLiteral(const Lines& lines) {
+        int indent;
+        size_t at = pickInsertion(lines, false, indent);
+        std::string pad(indent, ' ');
+        std::string name = freshName("az");
+        size_t length = 1 + pick(64);
+
+        std::string elements;
+        for (size_t e = 0; e < length; ++e) {
+            elements += (e ? ", " : "") + std::to_string(e);
+        }
+        Lines block = {pad + "var " + name + " = [" + elements + "]",
+                       pad + "print " + name + "[" + std::to_string(pick(length)) + "] + " + name + ".length"};
+        return insertAt(lines, at, block);
+    }
+
+    // Add a new function with branches and a loop, and call it
+    Lines insertFunction(const Lines& lines) {
+        int indent;
+        size_t at = pickInsertion(lines, true, indent);
+        std::string name = freshName("fz");
+        Lines block = {"func " + name + "(a, b):",
+                       "    var s = 0",
+                       "    while s < a:",
+                       "        if s % 2 == 0:",
+                       "            s = s + b",
+                       "        else:",
+                       "            s = s + 1",
+                       "    return s"};
+        Lines result = insertAt(lines, at, block);
+        result.push_back("print " + name + "(" + std::to_string(pick(10)) + ", 1)");
+        return result;
+    }
+
+    // Copy an existing function under a new name and call it
+    Lines cloneFunction(const Lines& lines) {
+        std::vector<size_t> functions;
+        for (size_t i = 0; i < lines.size(); i = blockEnd(lines, i)) {
+            if (startsWith(trimmed(lines[i]), "func ")) {
+                functions.push_back(i);
+            }
+        }
+        if (functions.empty()) {
+            return lines;
+        }
+        size_t start = functions[pick(functions.size())];
+        size_t end = blockEnd(lines, start);
+        std::string header = trimmed(lines[start]);
+        size_t paren = header.find('(');
+        size_t close = header.find(')');
+        if (paren == std::string::npos || close == std::string::npos) {
+            return lines;
+        }
+
+        std::string name = freshName("fc");
+        Lines copy(lines.begin() + start, lines.begin() + end);
+        copy[0] = "func " + name + header.substr(paren);
+
+        // Call it with as many literal arguments as it has parameters
+        std::string params = header.substr(paren + 1, close - paren - 1);
+        std::string args;
+        if (params.find_first_not_of(' ') != std::string::npos) {
+            size_t count = std::count(params.begin(), params.end(), ',') + 1;
+            for (size_t a = 0; a < count; ++a) {
+                args += (a ? ", " : "") + std::to_string(pick(10));
+            }
+        }
+        Lines result = insertAt(lines, end, copy);
+        result.push_back(name + "(" + args + ")");
+        return result;
+    }
+
+    // Insert a statement taken from another corpus program
+    Lines spliceFrom(const Lines& lines, const Lines& donor) {
+        size_t start;
+        if (!pickStatement(donor, start)) {
+            return lines;
+        }
+        size_t end = blockEnd(donor, start);
+        bool function = startsWith(trimmed(donor[start]), "func ");
+        int indent;
+        size_t at = pickInsertion(lines, function, indent);
+        return insertAt(lines, at, reindent(donor, start, end, indent));
+    }
+
+    // Drop a statement, which keeps inputs small and ratios per byte high
+    Lines deleteStatement(const Lines& lines) {
+        size_t start;
+        if (!pickStatement(lines, start)) {
+            return lines;
+        }
+        Lines result(lines.begin(), lines.begin() + start);
+        result.insert(result.end(), lines.begin() + blockEnd(lines, start), lines.end());
+        return result;
+    }
+};
+
+void printUsage() {
+    std::cout << "Vypr Performance Fuzzer - Finds inputs that make compilation super-linear\n";
+    std::cout << "Usage: vypr_perf_fuzz [options] <seed.vy | directory>...\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  -n <count>        Number of mutants to try (default 2000)\n";
+    std::cout << "  -s <seed>         Random seed (default 1)\n";
+    std::cout << "  -o <dir>          Directory for minimized findings (default perf_findings)\n";
+    std::cout << "  --max-bytes <n>   Largest mutant in bytes (default 16384)\n";
+    std::cout << "  --max-scale <k>   Largest growth factor of the scaling check (default 16)\n";
+    std::cout << "  -h, --help        Show this help message\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    FuzzOptions options;
+    std::vector<std::string> seedPaths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        try {
+            if (arg == "-n" && hasValue) {
+                options.iterations = std::stoi(argv[++i]);
+            } else if (arg == "-s" && hasValue) {
+                options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "-o" && hasValue) {
+                options.outputDir = argv[++i];
+            } else if (arg == "--max-bytes" && hasValue) {
+                options.maxInputBytes = std::stoul(argv[++i]);
+            } else if (arg == "--max-scale" && hasValue) {
+                options.maxScale = std::stoi(argv[++i]);
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else if (!arg.empty() && arg[0] == '-') {
+                std::cerr << "Error: Unknown or incomplete option '" << arg << "'\n";
+                printUsage();
+                return 1;
+            } else {
+                seedPaths.push_back(arg);
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value for " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (seedPaths.empty()) {
+        std::cerr << "Error: No seed programs specified\n";
+        printUsage();
+        return 1;
+    }
+
+    // Expand directories to the .vy files they contain
+    std::vector<std::string> seedFiles;
+    for (const auto& path : seedPaths) {
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::directory_iterator(path)) {
+                if (entry.path().extension() == ".vy") {
+                    seedFiles.push_back(entry.path().string());
+                }
+            }
+        } else {
+            seedFiles.push_back(path);
+        }
+    }
+    std::sort(seedFiles.begin(), seedFiles.end());
+
+    PerfFuzzer fuzzer(options);
+    int loaded = 0;
+    for (const auto& file : seedFiles) {
+        std::ifstream in(file);
+        if (!in.is_open()) {
+            std::cerr << "Error: Could not open seed file: " << file << "\n";
+            return 1;
+        }
+        std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (fuzzer.addSeed(source)) {
+            loaded++;
+        } else {
+            std::cerr << "Warning: Seed does not compile, skipped: " << file << "\n";
+        }
+    }
+    if (loaded == 0) {
+        std::cerr << "Error: No seed program compiles\n";
+        return 1;
+    }
+
+    std::cout << "Fuzzing with " << loaded << " seed(s), " << options.iterations << " iterations\n";
+    fuzzer.run();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef VYPR_ALIAS_ANALYSIS_H
+#define VYPR_ALIAS_ANALYSIS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ir_generator.h"
+#include "dataflow.h"
+
+namespace vypr {
+
+// What a call does to the arrays reachable from its arguments. "Parameter
+// k's arrays" are the array passed as argument k and the arrays inside it.
+struct ArrayEffects {
+    std::vector<bool> modifies;    // Writes one of parameter k's arrays
+    std::vector<bool> escapes;     // Stores one of parameter k's arrays where it outlives the call
+    std::vector<bool> returns;     // The result may be or contain one of parameter k's arrays
+    bool modifiesGlobals = false;  // Writes arrays the caller cannot see through its arguments
+    bool returnsGlobals = false;   // The result may be or contain such an array
+
+    // Effects of a function nothing is known about
+    static ArrayEffects unknown(size_t arity);
+    bool operator==(const ArrayEffects& other) const;
+};
+
+// Effects of every function of a module, iterated to a fixed point so
+// recursive calls are covered
+class ArraySummaries {
+public:
+    // `progress` is passed on to the analysis of every function
+    explicit ArraySummaries(const std::vector<IRFunction>& functions,
+                            const std::function<void(size_t)>& progress = nullptr);
+
+    // Effects of calling `callee` with `arity` arguments; unknown callees and
+    // mismatched arities get ArrayEffects::unknown
+    ArrayEffects effectsOf(const std::string& callee, size_t arity) const;
+
+private:
+    std::unordered_map<std::string, ArrayEffects> effects;
+    std::unordered_map<std::string, std::string> aliases;  // Merged function -> function it runs
+};
+
+// Flow-insensitive points-to and escape analysis of the arrays of one
+// function. The abstract arrays are the ARRAY_NEW sites, the results of
+// calls and of list operators, each parameter and the arrays inside it, and
+// one for arrays obtained from globals or unknown callees. Arrays that came
+// from outside the function, or were handed out, may alias one another.
+class ArrayAliasAnalysis {
+public:
+    // `progress`, if set, is told the instructions scanned every few thousand
+    // and may throw to abandon the analysis
+    ArrayAliasAnalysis(const IRFunction& function, const ArraySummaries* summaries = nullptr,
+                       const std::function<void(size_t)>& progress = nullptr);
+
+    // Whether two names may hold the same array
+    bool mayAlias(const std::string& a, const std::string& b) const;
+    // Whether the arrays reachable from two names may overlap
+    bool mayShare(const std::string& a, const std::string& b) const;
+    // Whether an array the name may hold is written anywhere in the function
+    bool mayBeModified(const std::string& name) const;
+    // Whether instruction `index` may write an array the name may hold
+    bool mayModify(size_t index, const std::string& name) const;
+    // Whether an array the name may hold can be reached outside the function
+    bool mayEscape(const std::string& name) const;
+
+    // Summary of the function for its callers
+    ArrayEffects effects() const;
+
+private:
+    const IRFunction& function;
+    NameTable names;
+    std::vector<BitVector> pointsTo;            // Name id -> arrays it may hold
+    std::vector<BitVector> contents;            // Array -> arrays stored in it
+    std::unordered_map<size_t, BitVector> writes;  // ARRAY_SET / CALL -> arrays it may write
+    BitVector modified;                         // Arrays written anywhere
+    BitVector exposed;                          // Arrays code outside the function can reach
+    BitVector published;                        // Exposed by this function (stored or passed on)
+    BitVector returned;                         // Reachable from the returned values
+    size_t arrayCount;
+
+    BitVector arraysOf(const std::string& name) const;
+    BitVector reach(BitVector arrays) const;
+    bool overlap(const BitVector& a, const BitVector& b) const;
+};
+
+} // namespace vypr
+
+#endif // VYPR_ALIAS_ANALYSIS_H
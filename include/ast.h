@@ -209,6 +209,25 @@ public:
     }
 };
 
+// Destructuring declaration: var a, b = expr
+class DestructuringDeclaration : public Statement {
+public:
+    std::vector<std::string> names;
+    ExpressionPtr initializer;
+    
+    DestructuringDeclaration(std::vector<std::string> names, ExpressionPtr initializer)
+        : names(std::move(names)), initializer(std::move(initializer)) {}
+
+    void print(std::ostream& out, int indent = 0) const override {
+        out << std::string(indent, ' ') << "DestructuringDecl: ";
+        for (size_t i = 0; i < names.size(); ++i) {
+            out << names[i] << (i < names.size() - 1 ? ", " : "");
+        }
+        out << " =\n";
+        initializer->print(out, indent + 2);
+    }
+};
+
 // Block statement
 class BlockStatement : public Statement {
 public:
@@ -303,19 +322,21 @@ public:
     }
 };
 
-// Return statement
+// Return statement (empty for a void return, several for return a, b)
 class ReturnStatement : public Statement {
 public:
-    ExpressionPtr value;
+    std::vector<ExpressionPtr> values;
     
-    explicit ReturnStatement(ExpressionPtr value)
-        : value(std::move(value)) {}
+    explicit ReturnStatement(std::vector<ExpressionPtr> values)
+        : values(std::move(values)) {}
 
     void print(std::ostream& out, int indent = 0) const override {
         out << std::string(indent, ' ') << "Return:";
-        if (value) {
+        if (!values.empty()) {
             out << "\n";
-            value->print(out, indent + 2);
+            for (const auto& value : values) {
+                value->print(out, indent + 2);
+            }
         } else {
             out << " (void)\n";
         }
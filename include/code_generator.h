@@ -17,15 +17,28 @@ public:
     // Generate Python code from IR
     void generate(const std::vector<IRFunction>& functions, const std::string& outputFile);
     
+    // Wrap every function with timing that is written to a JSON file at exit
+    void enableLatencyInstrumentation(const std::string& reportFile);
+    
+    // Record the operand types of every BINARY_OP and CALL site, written to a
+    // type profile at exit
+    void enableTypeProfiling(const std::string& profileFile);
+    
 private:
     bool verbose;
+    std::string latencyReportFile;  // Empty when latency instrumentation is off
+    std::string typeProfileFile;    // Empty when type profiling is off
     std::ofstream outFile;
     using HandlerFunc = std::string (CodeGenerator::*)(const IRInstruction&);
     std::unordered_map<IROpCode, HandlerFunc> opcodeHandlers;
     
     // Helper methods
     void writeHeader();
+    void writeLatencyRuntime();
+    void writeTypeProfileRuntime();
+    std::string observeTypes(const IRFunction& function, size_t index) const;
     void writeFunction(const IRFunction& function);
+    void writeAlias(const IRFunction& function);
     void writeInstruction(const IRInstruction& instruction);
     
     // Specific IR instruction handlers
@@ -46,11 +59,13 @@ private:
     std::string handleArraySet(const IRInstruction& instruction);
     std::string handleMemberGet(const IRInstruction& instruction);
     std::string handleConvert(const IRInstruction& instruction);
+    std::string handleUnpack(const IRInstruction& instruction);
     std::string handleLabel(const IRInstruction& instruction);
     std::string handleNop(const IRInstruction& instruction);
     
     // Utility methods
     std::string getIndent(int level) const;
+    std::string pythonStringLiteral(const std::string& text) const;
     std::string getPythonOperator(TokenType op) const;
 };
 
@@ -8,7 +8,9 @@
 #include "parser.h"
 #include "semantic_analyzer.h"
 #include "ir_generator.h"
+#include "ir_optimizer.h"
 #include "code_generator.h"
+#include "pyext_generator.h"
 #include "exceptions.h"
 
 namespace vypr {
@@ -18,18 +20,39 @@ public:
     explicit CompilationError(const std::string& message) : std::runtime_error(message) {}
 };
 
+// Output targets of the compiler
+enum class Target {
+    PYTHON,  // Python source file (default)
+    PYEXT    // CPython extension module built from generated C
+};
+
+// Settings chosen on the command line
+struct CompilerOptions {
+    Target target = Target::PYTHON;
+    bool instrument_latency = false;  // Per-function latency histograms (Python target)
+    bool instrument_types = false;    // Operand type profile per BINARY_OP/CALL site (Python target)
+    std::string profile_file;         // Type profile to speculate on (PYEXT target)
+    bool optimize = true;             // Run the IR optimizer (-O1, the default) or not (-O0)
+    OptimizationBudget budget;        // Effort the optimizer may spend before falling back to -O0
+};
+
 class Compiler {
 public:
-    Compiler(bool verbose = false);
+    Compiler(bool verbose = false, const CompilerOptions& options = CompilerOptions());
     
     // Compile a Vypr source file to a Python output file
     void compile(const std::string& sourceFile, const std::string& outputFile, bool verbose);
     
+    // Path of the extension module built by the last PYEXT compilation
+    const std::string& getExtensionFile() const { return extension_file; }
+    
     // Compile and run a Vypr program (generates Python and executes it)
     void compileAndRun(const std::string& sourceFile, const std::string& outputExe = "");
     
 private:
     bool verbose;
+    CompilerOptions options;
+    std::string extension_file;
     
     // Read source file content
     std::string readSourceFile(const std::string& sourceFile);
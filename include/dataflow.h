@@ -0,0 +1,165 @@
+#ifndef VYPR_DATAFLOW_H
+#define VYPR_DATAFLOW_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "ir_generator.h"
+
+namespace vypr {
+
+// Dense set of the integers [0, size)
+class BitVector {
+public:
+    explicit BitVector(size_t size = 0, bool value = false);
+
+    size_t size() const { return bits; }
+    bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    void set(size_t i) { words[i / 64] |= std::uint64_t(1) << (i % 64); }
+    void reset(size_t i) { words[i / 64] &= ~(std::uint64_t(1) << (i % 64)); }
+
+    // Set operations return whether this set changed
+    bool unionWith(const BitVector& other);
+    bool intersectWith(const BitVector& other);
+    bool subtract(const BitVector& other);
+
+    bool intersects(const BitVector& other) const;
+    size_t count() const;
+
+    // Calls visit(i) for every member in increasing order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (size_t bit = 0; bit < 64 && (words[w] >> bit) != 0; ++bit) {
+                if ((words[w] >> bit) & 1) {
+                    visit(w * 64 + bit);
+                }
+            }
+        }
+    }
+    bool operator==(const BitVector& other) const { return words == other.words; }
+    bool operator!=(const BitVector& other) const { return words != other.words; }
+
+private:
+    size_t bits;
+    std::vector<std::uint64_t> words;
+};
+
+// Interned strings with dense ids from 0
+class NameTable {
+public:
+    size_t intern(const std::string& name);
+    // Id of a name, -1 if it was never interned
+    long find(const std::string& name) const;
+    const std::string& name(size_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+    void reserve(size_t count) { ids.reserve(count); names.reserve(count); }
+
+private:
+    std::unordered_map<std::string, size_t> ids;
+    std::vector<std::string> names;
+};
+
+// Straight-line run of instructions [begin, end) of a function
+struct BasicBlock {
+    size_t begin;
+    size_t end;
+    std::vector<size_t> successors;
+    std::vector<size_t> predecessors;
+};
+
+// Name ids read or written by one instruction
+struct NameIds {
+    const size_t* first;
+    const size_t* last;
+    const size_t* begin() const { return first; }
+    const size_t* end() const { return last; }
+};
+
+// Basic blocks of an IR function. Blocks start at the entry, at labels and
+// after jumps and returns; block 0 is the entry.
+class ControlFlowGraph {
+public:
+    explicit ControlFlowGraph(const IRFunction& function);
+
+    const IRFunction& function() const { return *source; }
+    const std::vector<BasicBlock>& blocks() const { return nodes; }
+    size_t blockOf(size_t instruction) const { return owner[instruction]; }
+
+    // Blocks reachable from the entry, in reverse postorder
+    const std::vector<size_t>& reversePostorder() const { return order; }
+
+    // Every variable and temp of the function, interned once so analyses
+    // work on ids instead of hashing names per instruction
+    const NameTable& names() const { return symbols; }
+    NameIds uses(size_t instruction) const { return range(useStart, useIds, instruction); }
+    NameIds defs(size_t instruction) const { return range(defStart, defIds, instruction); }
+
+private:
+    const IRFunction* source;
+    std::vector<BasicBlock> nodes;
+    std::vector<size_t> owner;   // Instruction -> block
+    std::vector<size_t> order;
+    NameTable symbols;
+    std::vector<size_t> useStart, useIds;  // Instruction i reads useIds[useStart[i], useStart[i + 1])
+    std::vector<size_t> defStart, defIds;
+
+    static NameIds range(const std::vector<size_t>& start, const std::vector<size_t>& ids, size_t i) {
+        return {ids.data() + start[i], ids.data() + start[i + 1]};
+    }
+};
+
+enum class DataflowDirection { FORWARD, BACKWARD };
+enum class DataflowMeet { UNION, INTERSECTION };
+
+// A gen/kill problem: out = gen | (in - kill) for forward problems and
+// in = gen | (out - kill) for backward ones, per block
+struct DataflowProblem {
+    DataflowDirection direction = DataflowDirection::FORWARD;
+    DataflowMeet meet = DataflowMeet::UNION;
+    size_t domain = 0;
+    std::vector<BitVector> gen;
+    std::vector<BitVector> kill;
+    BitVector boundary;  // At the entry (forward) or at the exits (backward)
+};
+
+struct DataflowResult {
+    std::vector<BitVector> in;   // At block starts
+    std::vector<BitVector> out;  // At block ends
+    size_t visits = 0;           // Transfer functions evaluated
+};
+
+// Worklist solver visiting blocks in reverse postorder (forward problems) or
+// postorder (backward problems). Unreachable blocks keep the meet's identity.
+DataflowResult solveDataflow(const ControlFlowGraph& cfg, const DataflowProblem& problem);
+
+// Solution of one of the analyses below. Only names that cross a block
+// boundary are tracked (and parameters for definite initialization); names
+// confined to one block are answered by scanning that block.
+struct DataflowFacts {
+    NameTable domain;
+    DataflowResult result;
+    std::vector<size_t> definitions;  // Reaching definitions: id -> defining instruction
+};
+
+// Variables live at block boundaries (backward, union)
+DataflowFacts computeLiveness(const ControlFlowGraph& cfg);
+
+// Definitions "<name>@<instruction>" reaching block boundaries (forward, union)
+DataflowFacts computeReachingDefinitions(const ControlFlowGraph& cfg);
+
+// Expressions such as "(a + 1)" over variables and constants, computed on
+// every path and not invalidated since (forward, intersection)
+DataflowFacts computeAvailableExpressions(const ControlFlowGraph& cfg);
+
+// Variables assigned on every path from the entry (forward, intersection)
+DataflowFacts computeDefiniteInitialization(const ControlFlowGraph& cfg);
+
+// Whether `name` is assigned on every path to instruction `index`
+bool isDefinitelyInitialized(const ControlFlowGraph& cfg, const DataflowFacts& facts, size_t index,
+                             const std::string& name);
+
+} // namespace vypr
+
+#endif // VYPR_DATAFLOW_H
@@ -24,7 +24,7 @@ enum class IROpCode {
     JUMP_IF_FALSE,     // Jump if condition is false
     JUMP_IF_TRUE,      // Jump if condition is true
     CALL,              // Function call
-    RETURN,            // Return from function
+    RETURN,            // Return from function (one operand per returned value)
     PRINT,             // Print value
     INPUT,             // Get input
     ARRAY_NEW,         // Create new array
@@ -33,12 +33,20 @@ enum class IROpCode {
     MEMBER_GET,        // Get object member
     LABEL,             // Label for jumps
     CONVERT,           // Type conversion
+    UNPACK,            // Unpack a multi-value result into variables
     NOP                // No operation
 };
 
 // Helper function to convert IR opcode to string
 std::string irOpCodeToString(IROpCode opcode);
 
+// Helpers for comma-separated operand lists (CALL arguments, ARRAY_NEW elements)
+std::vector<std::string> splitOperandList(const std::string& list);
+std::string joinOperandList(const std::vector<std::string>& items);
+
+// True if the operand names a temp or variable rather than a literal
+bool isIRName(const std::string& operand);
+
 // Basic IR instruction
 struct IRInstruction {
     IROpCode opcode;
@@ -65,12 +73,17 @@ struct IRInstruction {
     }
 };
 
+// Names written by an instruction and names it reads
+std::vector<std::string> irDefinedNames(const IRInstruction& instruction);
+std::vector<std::string> irUsedNames(const IRInstruction& instruction);
+
 // Function information for IR generation
 struct IRFunction {
     std::string name;
     std::vector<std::string> parameters;
     std::vector<IRInstruction> instructions;
     int labelCounter;
+    std::string aliasOf;  // Set when merged into an identical function; the body is then empty
     
     IRFunction(std::string name, std::vector<std::string> parameters)
         : name(std::move(name)), parameters(std::move(parameters)), labelCounter(0) {}
@@ -103,6 +116,7 @@ private:
     std::string visit(const ExpressionPtr& expr);
     
     void visitVarDeclaration(const std::shared_ptr<VarDeclarationStatement>& stmt);
+    void visitDestructuringDeclaration(const std::shared_ptr<DestructuringDeclaration>& stmt);
     void visitFunctionDeclaration(const std::shared_ptr<FunctionDeclaration>& stmt);
     void visitExpressionStatement(const std::shared_ptr<ExpressionStatement>& stmt);
     void visitIfStatement(const std::shared_ptr<IfStatement>& stmt, const std::string& finalEndLabel = "");
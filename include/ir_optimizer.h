@@ -0,0 +1,96 @@
+#ifndef VYPR_IR_OPTIMIZER_H
+#define VYPR_IR_OPTIMIZER_H
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "ir_generator.h"
+#include "alias_analysis.h"
+
+namespace vypr {
+
+// Limits on how much effort the optimizer spends; 0 means no limit. Work is
+// counted in instructions scanned by the passes, so work limits give the same
+// result on every machine while time limits bound the latency.
+struct OptimizationBudget {
+    double passMilliseconds = 0;      // One pass over one function (or the module)
+    double functionMilliseconds = 0;  // All passes over one function
+    double totalMilliseconds = 0;     // The whole optimize() call
+    size_t passWork = 50000000;
+    size_t functionWork = 100000000;
+    size_t totalWork = 500000000;
+};
+
+class IROptimizer {
+public:
+    IROptimizer(bool verbose = false, const OptimizationBudget& budget = OptimizationBudget());
+
+    // Run all optimization passes over the IR in place. A function whose
+    // passes go over budget is put back the way it was generated (-O0).
+    void optimize(std::vector<IRFunction>& functions);
+
+    // Notes on functions that were not optimized, for the user
+    const std::vector<std::string>& getRemarks() const { return remarks; }
+
+private:
+    bool verbose;
+    OptimizationBudget budget;
+    std::vector<std::string> remarks;
+    using PassFunc = bool (IROptimizer::*)(IRFunction&);
+    std::vector<std::pair<std::string, PassFunc>> passes;
+    using ModulePassFunc = bool (IROptimizer::*)(std::vector<IRFunction>&);
+    std::vector<std::pair<std::string, ModulePassFunc>> modulePasses;
+    const ArraySummaries* summaries = nullptr;  // Effects of the module's functions while optimize() runs
+
+    // Budget accounting. Passes call charge() as they scan the IR, which
+    // throws BudgetExceeded once a limit is crossed.
+    using Clock = std::chrono::steady_clock;
+    struct Meter {
+        Clock::time_point start;
+        size_t work = 0;
+    };
+    struct BudgetExceeded : std::runtime_error {
+        bool total;  // The whole optimize() call ran out, not just this function
+        BudgetExceeded(const std::string& message, bool total) : std::runtime_error(message), total(total) {}
+    };
+    Meter passMeter, functionMeter, totalMeter;
+    bool inFunction = false;  // Whether the function limits apply to the running pass
+    void charge(size_t work);
+
+    // A while-shaped loop: LABEL head, pure condition, JUMP_IF_FALSE to the
+    // exit, body, JUMP back to head, LABEL exit. Only entered at the head and
+    // only left through the exit label (or RETURN).
+    struct Loop {
+        size_t head;   // LABEL at the top
+        size_t test;   // JUMP_IF_FALSE that leaves the loop
+        size_t latch;  // JUMP back to the head
+        size_t exit;   // LABEL right after the latch
+    };
+
+    // Optimization passes (return true if the function was changed)
+    bool scalarReplaceArrays(IRFunction& function);
+    bool interchangeLoops(IRFunction& function);
+    bool hoistInvariantLookups(IRFunction& function);
+
+    // Module passes, run after the function passes (return true if anything changed)
+    bool mergeIdenticalFunctions(std::vector<IRFunction>& functions);
+
+    // Utility methods
+    std::vector<Loop> findLoops(const IRFunction& function);
+    std::vector<IRInstruction> cloneWithFreshNames(const std::vector<IRInstruction>& block,
+                                                   const std::unordered_set<std::string>& keep,
+                                                   std::unordered_set<std::string>& taken) const;
+    std::unordered_set<std::string> namesIn(const IRFunction& function) const;
+    std::string canonicalForm(const IRFunction& function,
+                              const std::unordered_map<std::string, std::string>& aliases) const;
+    std::string generateName(const std::string& base, std::unordered_set<std::string>& taken) const;
+    void log(const std::string& message) const;
+};
+
+} // namespace vypr
+
+#endif // VYPR_IR_OPTIMIZER_H
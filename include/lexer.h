@@ -10,11 +10,36 @@
 
 namespace vypr {
 
+// Resumable lexer state recorded at the start of each line
+struct LexerCheckpoint {
+    int position;
+    int line;
+    int column;
+    std::stack<int> indent_stack;
+    size_t token_index;  // Index of the first token lexed from this point
+};
+
+// Replacement of source[start, start + old_length) with new_text
+struct SourceEdit {
+    int start;
+    int old_length;
+    std::string new_text;
+};
+
 class Lexer {
 public:
     Lexer(const std::string& source);
     std::vector<Token> tokenize();
     Token next_token();
+    
+    // Apply an edit and re-tokenize only the affected region. Lexing restarts
+    // at the nearest checkpoint before the edit and stops as soon as its state
+    // matches a checkpoint of the previous token stream.
+    const std::vector<Token>& relex(const SourceEdit& edit);
+    
+    const std::string& get_source() const { return source; }
+    const std::vector<Token>& get_tokens() const { return tokens; }
+    size_t last_relexed_count() const { return last_relexed; }
 
 private:
     std::string source;
@@ -27,8 +52,17 @@ private:
     bool at_line_start;
     std::queue<Token> token_queue;
     
+    // Token stream and line-start checkpoints from the last tokenize()/relex()
+    std::vector<Token> tokens;
+    std::vector<LexerCheckpoint> checkpoints;
+    size_t last_relexed;
+    
     static std::unordered_map<std::string, TokenType> keywords;
 
+    void reset();
+    void restore(const LexerCheckpoint& checkpoint);
+    bool at_checkpoint(const std::vector<LexerCheckpoint>& recorded) const;
+    
     void advance();
     char peek() const;
     void skip_whitespace();
@@ -0,0 +1,114 @@
+#ifndef VYPR_PYEXT_GENERATOR_H
+#define VYPR_PYEXT_GENERATOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <fstream>
+#include "ir_generator.h"
+#include "type_profile.h"
+
+namespace vypr {
+
+class ValueRangeAnalysis;
+
+// Lowers IR to C against the CPython C API and builds it into an extension
+// module. Every Vypr function becomes a native callable of the module.
+class PyExtGenerator {
+public:
+    PyExtGenerator(bool verbose = false);
+
+    // Generate the C source of extension module `moduleName` from IR
+    void generate(const std::vector<IRFunction>& functions, const std::string& moduleName, const std::string& outputFile);
+
+    // Compile the generated C source with the local toolchain, returns the
+    // path of the built shared library
+    std::string build(const std::string& sourceFile, const std::string& outputBase);
+
+    // Speculate on the operand types recorded in `profile`: BINARY_OP sites
+    // get fast paths and CALL sites call copies of the callee specialized for
+    // the argument types, each behind a type guard that falls back to the
+    // generic code. Guard hits and misses are written to `reportFile` at exit.
+    void useTypeProfile(const TypeProfile& profile, const std::string& reportFile);
+
+private:
+    // How one C function is generated under a type profile. Functions have a
+    // generic variant and may have variants specialized for parameter types.
+    struct VariantPlan {
+        const IRFunction* function = nullptr;
+        std::vector<std::string> parameterTypes;           // "" when not specialized
+        std::map<std::string, std::string> known;          // Names whose type is certain
+        std::map<size_t, std::vector<std::string>> types;  // Speculated operand types per site
+        std::map<size_t, std::string> targets;             // Specialized callee per CALL site
+    };
+
+    bool verbose;
+    std::ofstream outFile;
+    std::map<std::string, int> constants;   // Literal text -> constant pool index
+    std::set<std::string> functionNames;    // Functions defined in the module
+    std::map<std::string, std::string> aliases;  // Merged function -> function holding its body
+
+    std::map<std::string, VariantPlan> variants;  // C function name -> how to generate it
+    std::vector<std::string> variantOrder;        // C functions in generation order
+
+    // Speculation state, only used with a type profile
+    const TypeProfile* profile = nullptr;
+    std::string guardReportFile;
+    std::map<std::string, size_t> guardSlots;      // Site -> index of its guard counters
+    std::vector<std::string> guardSites;
+    std::vector<std::string> guardWhat;            // Operator or callee per guard slot
+    std::vector<std::string> guardTypes;           // Speculated operand types per guard slot
+    const VariantPlan* currentPlan = nullptr;      // Plan of the function being written
+    size_t currentIndex = 0;                       // Index of the instruction being written
+    std::vector<bool> boundLoads;                  // LOAD_VARs whose variable is assigned on every path
+    const ValueRangeAnalysis* ranges = nullptr;    // Integer ranges of the function being written
+
+    // Helper methods
+    void writeHeader();
+    void writeConstants();
+    void writeFunction(const IRFunction& function, const std::string& cName);
+    void writeSpeculationRuntime();
+    void planSpeculation(const std::vector<IRFunction>& functions);
+    std::string addVariant(const IRFunction& function, const std::vector<std::string>& parameterTypes);
+    void planVariant(const std::string& cName, const std::map<std::string, const IRFunction*>& bodies);
+    std::string staticType(const std::string& operand, const VariantPlan& plan) const;
+    void addGuard(const std::string& site, const std::string& what, const std::vector<std::string>& types);
+    std::string guarded(const std::string& target, const std::vector<std::string>& operands,
+                        const std::vector<std::string>& types, const std::string& fast, const std::string& generic);
+    void writeModule(const std::vector<IRFunction>& functions, const std::string& moduleName);
+    void collectConstants(const IRFunction& function);
+
+    // Specific IR instruction handlers (return C statements)
+    std::string handleLoadConst(const IRInstruction& instruction);
+    std::string handleLoadVar(const IRInstruction& instruction);
+    std::string handleStoreVar(const IRInstruction& instruction);
+    std::string handleBinaryOp(const IRInstruction& instruction);
+    std::string binaryOpExpression(const IRInstruction& instruction) const;
+    std::string unboxedBinaryOp(const IRInstruction& instruction) const;
+    std::string handleUnaryOp(const IRInstruction& instruction);
+    std::string handleJump(const IRInstruction& instruction);
+    std::string handleConditionalJump(const IRInstruction& instruction);
+    std::string handleCall(const IRInstruction& instruction);
+    std::string handleReturn(const IRInstruction& instruction);
+    std::string handlePrint(const IRInstruction& instruction);
+    std::string handleInput(const IRInstruction& instruction);
+    std::string handleArrayNew(const IRInstruction& instruction);
+    std::string handleArrayGet(const IRInstruction& instruction);
+    std::string handleArraySet(const IRInstruction& instruction);
+    std::string handleMemberGet(const IRInstruction& instruction);
+    std::string handleConvert(const IRInstruction& instruction);
+    std::string handleUnpack(const IRInstruction& instruction);
+    std::string handleLabel(const IRInstruction& instruction);
+
+    // Utility methods
+    std::string value(const std::string& operand) const;
+    std::string local(const std::string& name) const;
+    std::string assign(const std::string& target, const std::string& expression) const;
+    std::string cStringLiteral(const std::string& text) const;
+    std::string runCommand(const std::string& command) const;
+};
+
+} // namespace vypr
+
+#endif // VYPR_PYEXT_GENERATOR_H
@@ -21,9 +21,10 @@ struct Symbol {
     Type type;
     bool initialized;
     int paramCount;  // Only for functions
+    int returnCount; // Only for functions, values per return (-1 if unknown)
     
-    explicit Symbol(Type type, bool initialized = true, int paramCount = 0)
-        : type(type), initialized(initialized), paramCount(paramCount) {}
+    explicit Symbol(Type type, bool initialized = true, int paramCount = 0, int returnCount = -1)
+        : type(type), initialized(initialized), paramCount(paramCount), returnCount(returnCount) {}
 };
 
 class Scope {
@@ -47,6 +48,8 @@ public:
 private:
     Scope* current_scope;
     bool in_function;
+    int function_return_count;  // Values returned by the function being analyzed (-1 if none yet)
+    const CallExpression* multi_value_call;  // Call whose several return values are all used, if any
     
     void enterScope();
     void exitScope();
@@ -57,6 +60,7 @@ private:
     void visit(const ExpressionPtr& expr);
     
     void visitVarDeclaration(const std::shared_ptr<VarDeclarationStatement>& stmt);
+    void visitDestructuringDeclaration(const std::shared_ptr<DestructuringDeclaration>& stmt);
     void visitFunctionDeclaration(const std::shared_ptr<FunctionDeclaration>& stmt);
     void visitExpressionStatement(const std::shared_ptr<ExpressionStatement>& stmt);
     void visitIfStatement(const std::shared_ptr<IfStatement>& stmt);
@@ -0,0 +1,44 @@
+#ifndef VYPR_TYPE_PROFILE_H
+#define VYPR_TYPE_PROFILE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace vypr {
+
+// Operand types observed at one BINARY_OP or CALL site during a profiling run
+struct SiteProfile {
+    std::string what;                             // Operator or callee, to detect a stale profile
+    std::map<std::string, std::uint64_t> types;   // "int,float" -> number of executions
+
+    std::uint64_t total() const;
+
+    // The operand types seen in at least `share` of the executions, empty
+    // when the site is polymorphic
+    std::vector<std::string> dominant(double share) const;
+};
+
+// Type profile written by a program compiled with --instrument=types. Sites
+// are named "<function>:<instruction index>" in the optimized IR.
+class TypeProfile {
+public:
+    static std::string siteId(const std::string& function, size_t index);
+
+    // Read a profile file, throws CompileError when it cannot be read
+    void load(const std::string& file);
+
+    // Profile of a site whose operator or callee is `what`, nullptr if the
+    // site was never reached or the profile belongs to different code
+    const SiteProfile* find(const std::string& site, const std::string& what) const;
+
+    size_t size() const { return sites.size(); }
+
+private:
+    std::map<std::string, SiteProfile> sites;
+};
+
+} // namespace vypr
+
+#endif // VYPR_TYPE_PROFILE_H
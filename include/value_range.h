@@ -0,0 +1,78 @@
+#ifndef VYPR_VALUE_RANGE_H
+#define VYPR_VALUE_RANGE_H
+
+#include <climits>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ir_generator.h"
+#include "dataflow.h"
+
+namespace vypr {
+
+// Closed interval of integers. The int64 limits stand for -infinity and
+// +infinity, and arithmetic saturates to them, so a range with two finite
+// bounds was computed without overflow.
+struct IntRange {
+    static constexpr long long kMinusInfinity = LLONG_MIN;
+    static constexpr long long kPlusInfinity = LLONG_MAX;
+
+    long long lo = kMinusInfinity;
+    long long hi = kPlusInfinity;
+
+    static IntRange point(long long value) { return {value, value}; }
+    bool empty() const { return lo > hi; }
+    // Every value fits a signed 64-bit machine integer
+    bool isFinite() const { return lo != kMinusInfinity && hi != kPlusInfinity; }
+    bool operator==(const IntRange& other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const IntRange& other) const { return !(*this == other); }
+    std::string toString() const;
+};
+
+// Interval analysis of the integers of one function. A name only gets a
+// range where it certainly holds an exact int (not a bool, float or string):
+// integer literals, lengths, and +, -, *, % and int() of ints. Ranges come
+// from the loop tests: on the branch where `i < n` holds, i is below n, and
+// where n is `a.length` the analysis also remembers that i indexes a within
+// bounds until a is reassigned (Vypr lists never change length). Loop heads
+// are widened to infinity and then narrowed by a few more passes, so a
+// counter such as the one of `loop n times` ends up bounded by n.
+class ValueRangeAnalysis {
+public:
+    explicit ValueRangeAnalysis(const ControlFlowGraph& cfg);
+
+    // Range of `operand` (a name or a literal) as instruction `index` reads
+    // it; false unless it certainly holds an int there
+    bool operandRange(size_t index, const std::string& operand, IntRange& range) const;
+    // Range of the int that instruction `index` defines; false if the result
+    // may be something else
+    bool resultRange(size_t index, IntRange& range) const;
+    // Whether the ARRAY_GET or ARRAY_SET at `index` uses an int index in
+    // [0, length) of its array
+    bool inBounds(size_t index) const;
+
+    // Blocks evaluated until the ranges were stable
+    size_t visits() const { return transfers; }
+
+private:
+    // What is known about one int name: its range and, if not -1, the id of
+    // a variable whose array is longer than the value
+    struct Fact {
+        IntRange range;
+        long below = -1;
+        bool operator==(const Fact& other) const { return range == other.range && below == other.below; }
+    };
+    // Facts of the names crossing block boundaries, sorted by name id; a
+    // missing name may hold anything
+    using State = std::vector<std::pair<size_t, Fact>>;
+
+    const ControlFlowGraph& cfg;
+    std::vector<std::vector<std::pair<size_t, IntRange>>> reads;  // Instruction -> int names it reads
+    std::vector<std::pair<bool, IntRange>> results;               // Instruction -> int it defines
+    std::vector<bool> checked;                                    // ARRAY_GET / ARRAY_SET within bounds
+    size_t transfers = 0;
+};
+
+} // namespace vypr
+
+#endif // VYPR_VALUE_RANGE_H
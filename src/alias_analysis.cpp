@@ -0,0 +1,430 @@
+#include "alias_analysis.h"
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
+
+namespace vypr {
+
+ArrayEffects ArrayEffects::unknown(size_t arity) {
+    ArrayEffects effects;
+    effects.modifies.assign(arity, true);
+    effects.escapes.assign(arity, true);
+    effects.returns.assign(arity, true);
+    effects.modifiesGlobals = true;
+    effects.returnsGlobals = true;
+    return effects;
+}
+
+bool ArrayEffects::operator==(const ArrayEffects& other) const {
+    return modifies == other.modifies && escapes == other.escapes && returns == other.returns &&
+           modifiesGlobals == other.modifiesGlobals && returnsGlobals == other.returnsGlobals;
+}
+
+ArraySummaries::ArraySummaries(const std::vector<IRFunction>& functions, const std::function<void(size_t)>& progress) {
+    for (const auto& function : functions) {
+        if (!function.aliasOf.empty()) {
+            aliases[function.name] = function.aliasOf;
+            continue;
+        }
+        // Callees start out harmless and gain effects until nothing changes
+        size_t arity = function.parameters.size();
+        effects[function.name] = {std::vector<bool>(arity), std::vector<bool>(arity), std::vector<bool>(arity)};
+    }
+
+    // Call graph over the analyzed functions, merged callees resolved
+    std::unordered_map<std::string, const IRFunction*> byName;
+    for (const auto& function : functions) {
+        if (function.aliasOf.empty()) {
+            byName[function.name] = &function;
+        }
+    }
+    auto resolve = [&](std::string name) {
+        for (size_t hops = 0; hops <= aliases.size(); ++hops) {
+            auto alias = aliases.find(name);
+            if (alias == aliases.end()) {
+                break;
+            }
+            name = alias->second;
+        }
+        return name;
+    };
+    std::unordered_map<std::string, std::vector<std::string>> callees;
+    std::unordered_map<std::string, std::vector<std::string>> callers;
+    for (const auto& [name, function] : byName) {
+        std::unordered_set<std::string> seen;
+        for (const auto& instruction : function->instructions) {
+            if (instruction.opcode != IROpCode::CALL || instruction.operands.size() < 2) {
+                continue;
+            }
+            std::string callee = resolve(instruction.operands[1]);
+            if (byName.count(callee) && seen.insert(callee).second) {
+                callees[name].push_back(callee);
+                callers[callee].push_back(name);
+            }
+        }
+    }
+
+    // Callees first (post-order of the call graph), so each function is
+    // usually analyzed once; a changed summary re-queues its callers
+    std::vector<std::string> order;
+    std::unordered_set<std::string> visited;
+    for (const auto& function : functions) {
+        if (!function.aliasOf.empty() || !visited.insert(function.name).second) {
+            continue;
+        }
+        std::vector<std::pair<std::string, size_t>> stack = {{function.name, 0}};
+        while (!stack.empty()) {
+            auto& [name, next] = stack.back();
+            const auto& targets = callees[name];
+            if (next < targets.size()) {
+                const std::string& callee = targets[next++];
+                if (visited.insert(callee).second) {
+                    stack.push_back({callee, 0});
+                }
+                continue;
+            }
+            order.push_back(name);
+            stack.pop_back();
+        }
+    }
+
+    std::deque<std::string> worklist(order.begin(), order.end());
+    std::unordered_set<std::string> queued(order.begin(), order.end());
+    while (!worklist.empty()) {
+        std::string name = worklist.front();
+        worklist.pop_front();
+        queued.erase(name);
+
+        ArrayEffects next = ArrayAliasAnalysis(*byName[name], this, progress).effects();
+        ArrayEffects& current = effects[name];
+        ArrayEffects joined = current;
+        for (size_t k = 0; k < joined.modifies.size(); ++k) {
+            joined.modifies[k] = joined.modifies[k] || next.modifies[k];
+            joined.escapes[k] = joined.escapes[k] || next.escapes[k];
+            joined.returns[k] = joined.returns[k] || next.returns[k];
+        }
+        joined.modifiesGlobals = joined.modifiesGlobals || next.modifiesGlobals;
+        joined.returnsGlobals = joined.returnsGlobals || next.returnsGlobals;
+        if (joined == current) {
+            continue;
+        }
+        current = joined;
+        for (const auto& caller : callers[name]) {
+            if (queued.insert(caller).second) {
+                worklist.push_back(caller);
+            }
+        }
+    }
+}
+
+ArrayEffects ArraySummaries::effectsOf(const std::string& callee, size_t arity) const {
+    std::string name = callee;
+    for (size_t hops = 0; hops <= aliases.size(); ++hops) {
+        auto alias = aliases.find(name);
+        if (alias == aliases.end()) {
+            break;
+        }
+        name = alias->second;
+    }
+    auto it = effects.find(name);
+    if (it == effects.end() || it->second.modifies.size() != arity) {
+        return ArrayEffects::unknown(arity);
+    }
+    return it->second;
+}
+
+// Abstract arrays: one for globals and unknown callees, one for the results
+// of list operators, two per parameter (the array and the arrays inside it),
+// then one per ARRAY_NEW and CALL
+static const size_t kExternal = 0;
+static const size_t kComputed = 1;
+static size_t parameterArray(size_t k) { return 2 + 2 * k; }
+static size_t innerArray(size_t k) { return 3 + 2 * k; }
+
+// Allocation sites beyond this many share one abstract array, which keeps the
+// sets a few words long in huge functions
+static const size_t kMaxSites = 256;
+
+// Instructions scanned between two progress reports
+static const size_t kProgressStep = 4096;
+
+ArrayAliasAnalysis::ArrayAliasAnalysis(const IRFunction& function, const ArraySummaries* summaries,
+                                       const std::function<void(size_t)>& progress)
+    : function(function) {
+    const auto& code = function.instructions;
+    // Every scan over the code reports its instructions in steps
+    auto scanning = [&](size_t i) {
+        if (progress && i % kProgressStep == 0) {
+            progress(std::min(kProgressStep, code.size() - i));
+        }
+    };
+    const auto& parameters = function.parameters;
+
+    arrayCount = 2 + 2 * parameters.size();
+    const size_t firstSite = arrayCount;
+    std::unordered_map<size_t, size_t> site;  // ARRAY_NEW / CALL -> its array
+    std::unordered_map<size_t, ArrayEffects> callEffects;
+    std::unordered_set<std::string> assigned(parameters.begin(), parameters.end());
+    for (const auto& parameter : parameters) {
+        names.intern(parameter);
+    }
+    for (size_t i = 0; i < code.size(); ++i) {
+        scanning(i);
+        if (code[i].opcode == IROpCode::ARRAY_NEW || code[i].opcode == IROpCode::CALL) {
+            size_t array = site.size() < kMaxSites ? arrayCount++ : firstSite + kMaxSites - 1;
+            site[i] = array;
+        }
+        if (code[i].opcode == IROpCode::CALL) {
+            size_t arity = code[i].operands.size() > 2 ? splitOperandList(code[i].operands[2]).size() : 0;
+            callEffects[i] = summaries ? summaries->effectsOf(code[i].operands[1], arity) : ArrayEffects::unknown(arity);
+        }
+        for (const auto& name : irDefinedNames(code[i])) {
+            names.intern(name);
+            assigned.insert(name);
+        }
+        for (const auto& name : irUsedNames(code[i])) {
+            names.intern(name);
+        }
+    }
+
+    pointsTo.assign(names.size(), BitVector(arrayCount));
+    contents.assign(arrayCount, BitVector(arrayCount));
+    modified = exposed = published = returned = BitVector(arrayCount);
+
+    contents[kExternal].set(kExternal);
+    exposed.set(kExternal);
+    BitVector incoming(arrayCount);
+    for (size_t k = 0; k < parameters.size(); ++k) {
+        pointsTo[names.find(parameters[k])].set(parameterArray(k));
+        contents[parameterArray(k)].set(innerArray(k));
+        contents[innerArray(k)].set(innerArray(k));
+        incoming.set(parameterArray(k));
+        incoming.set(innerArray(k));
+    }
+    exposed.unionWith(incoming);
+    // Names read but never assigned here are globals
+    for (size_t id = 0; id < names.size(); ++id) {
+        if (!assigned.count(names.name(id))) {
+            pointsTo[id].set(kExternal);
+        }
+    }
+
+    auto single = [&](size_t array) {
+        BitVector arrays(arrayCount);
+        arrays.set(array);
+        return arrays;
+    };
+    auto contentsOf = [&](const BitVector& arrays) {
+        BitVector inside(arrayCount);
+        arrays.forEach([&](size_t a) { inside.unionWith(contents[a]); });
+        return inside;
+    };
+    auto target = [&](const std::string& name) -> BitVector& { return pointsTo[names.find(name)]; };
+
+    // Subset constraints, applied until no set grows
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        auto flow = [&](BitVector& into, const BitVector& from) { changed = into.unionWith(from) || changed; };
+
+        for (size_t i = 0; i < code.size(); ++i) {
+            scanning(i);
+            const auto& ops = code[i].operands;
+            switch (code[i].opcode) {
+                case IROpCode::LOAD_VAR:
+                case IROpCode::STORE_VAR:
+                    flow(target(ops[0]), arraysOf(ops[1]));
+                    break;
+                case IROpCode::ARRAY_NEW:
+                    flow(target(ops[0]), single(site[i]));
+                    if (ops.size() > 1) {
+                        for (const auto& element : splitOperandList(ops[1])) {
+                            flow(contents[site[i]], arraysOf(element));
+                        }
+                    }
+                    break;
+                case IROpCode::ARRAY_GET:
+                    flow(target(ops[0]), contentsOf(arraysOf(ops[1])));
+                    break;
+                case IROpCode::MEMBER_GET:
+                    if (ops[2] != "length") {
+                        flow(target(ops[0]), contentsOf(arraysOf(ops[1])));
+                    }
+                    break;
+                case IROpCode::ARRAY_SET: {
+                    BitVector base = arraysOf(ops[0]);
+                    BitVector value = arraysOf(ops[2]);
+                    base.forEach([&](size_t a) { flow(contents[a], value); });
+                    if (base.intersects(exposed)) {
+                        flow(published, reach(value));
+                    }
+                    break;
+                }
+                case IROpCode::BINARY_OP: {
+                    // List concatenation and repetition copy the references
+                    BitVector operands = arraysOf(ops[1]);
+                    operands.unionWith(arraysOf(ops[3]));
+                    if ((ops[2] == "+" || ops[2] == "*") && operands.count() > 0) {
+                        flow(target(ops[0]), single(kComputed));
+                        flow(contents[kComputed], contentsOf(operands));
+                    }
+                    break;
+                }
+                case IROpCode::UNPACK: {
+                    BitVector values = arraysOf(ops[0]);
+                    values.unionWith(contentsOf(values));
+                    for (size_t n = 1; n < ops.size(); ++n) {
+                        flow(target(ops[n]), values);
+                    }
+                    break;
+                }
+                case IROpCode::CALL: {
+                    const ArrayEffects& effects = callEffects[i];
+                    std::vector<std::string> arguments = ops.size() > 2 ? splitOperandList(ops[2]) : std::vector<std::string>();
+                    size_t result = site[i];
+
+                    BitVector escaping(arrayCount);
+                    for (size_t k = 0; k < arguments.size(); ++k) {
+                        if (effects.escapes[k]) {
+                            escaping.unionWith(reach(arraysOf(arguments[k])));
+                        }
+                    }
+                    flow(published, escaping);
+
+                    // The result is a new array, or whatever the callee hands back
+                    BitVector values = single(result);
+                    for (size_t k = 0; k < arguments.size(); ++k) {
+                        if (effects.returns[k]) {
+                            values.unionWith(reach(arraysOf(arguments[k])));
+                        }
+                    }
+                    if (effects.returnsGlobals) {
+                        values.set(kExternal);
+                        flow(exposed, single(result));
+                    }
+                    flow(contents[result], values);
+                    flow(target(ops[0]), values);
+
+                    // Arrays the callee writes may now hold its own arrays
+                    BitVector stored = escaping;
+                    stored.set(result);
+                    if (effects.modifiesGlobals || effects.returnsGlobals) {
+                        stored.set(kExternal);
+                    }
+                    for (size_t k = 0; k < arguments.size(); ++k) {
+                        if (effects.modifies[k]) {
+                            reach(arraysOf(arguments[k])).forEach([&](size_t a) { flow(contents[a], stored); });
+                        }
+                    }
+                    break;
+                }
+                case IROpCode::RETURN:
+                    for (const auto& value : ops) {
+                        flow(returned, reach(arraysOf(value)));
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Everything inside an exposed array is exposed, and code outside may
+        // have stored any other exposed array into it. (What parameters hold
+        // is already modelled by their inner arrays.)
+        flow(exposed, published);
+        flow(exposed, reach(exposed));
+        exposed.forEach([&](size_t a) {
+            if (!incoming.test(a)) {
+                flow(contents[a], single(kExternal));
+            }
+        });
+    }
+
+    for (size_t i = 0; i < code.size(); ++i) {
+        scanning(i);
+        const auto& ops = code[i].operands;
+        if (code[i].opcode == IROpCode::ARRAY_SET) {
+            writes[i] = arraysOf(ops[0]);
+        } else if (code[i].opcode == IROpCode::CALL) {
+            const ArrayEffects& effects = callEffects[i];
+            std::vector<std::string> arguments = ops.size() > 2 ? splitOperandList(ops[2]) : std::vector<std::string>();
+            BitVector written = effects.modifiesGlobals ? exposed : BitVector(arrayCount);
+            for (size_t k = 0; k < arguments.size(); ++k) {
+                if (effects.modifies[k]) {
+                    written.unionWith(reach(arraysOf(arguments[k])));
+                }
+            }
+            writes[i] = written;
+        } else {
+            continue;
+        }
+        modified.unionWith(writes[i]);
+    }
+}
+
+BitVector ArrayAliasAnalysis::arraysOf(const std::string& name) const {
+    long id = isIRName(name) ? names.find(name) : -1;
+    return id >= 0 ? pointsTo[id] : BitVector(arrayCount);
+}
+
+BitVector ArrayAliasAnalysis::reach(BitVector arrays) const {
+    bool grew = true;
+    while (grew) {
+        BitVector next = arrays;
+        arrays.forEach([&](size_t a) { next.unionWith(contents[a]); });
+        grew = arrays.unionWith(next);
+    }
+    return arrays;
+}
+
+bool ArrayAliasAnalysis::overlap(const BitVector& a, const BitVector& b) const {
+    return a.intersects(b) || (a.intersects(exposed) && b.intersects(exposed));
+}
+
+bool ArrayAliasAnalysis::mayAlias(const std::string& a, const std::string& b) const {
+    return overlap(arraysOf(a), arraysOf(b));
+}
+
+bool ArrayAliasAnalysis::mayShare(const std::string& a, const std::string& b) const {
+    return overlap(reach(arraysOf(a)), reach(arraysOf(b)));
+}
+
+bool ArrayAliasAnalysis::mayBeModified(const std::string& name) const {
+    return overlap(modified, arraysOf(name));
+}
+
+bool ArrayAliasAnalysis::mayModify(size_t index, const std::string& name) const {
+    auto it = writes.find(index);
+    return it != writes.end() && overlap(it->second, arraysOf(name));
+}
+
+bool ArrayAliasAnalysis::mayEscape(const std::string& name) const {
+    BitVector outside = exposed;
+    outside.unionWith(returned);
+    return arraysOf(name).intersects(outside);
+}
+
+ArrayEffects ArrayAliasAnalysis::effects() const {
+    size_t arity = function.parameters.size();
+    ArrayEffects effects;
+    BitVector incoming(arrayCount);
+    for (size_t k = 0; k < arity; ++k) {
+        BitVector own(arrayCount);
+        own.set(parameterArray(k));
+        own.set(innerArray(k));
+        BitVector reachable = reach(own);
+        incoming.unionWith(reachable);
+        effects.modifies.push_back(modified.intersects(reachable));
+        effects.escapes.push_back(published.intersects(own));
+        effects.returns.push_back(returned.intersects(reachable));
+    }
+
+    // Exposed arrays the caller cannot reach through its arguments
+    BitVector globals = exposed;
+    globals.subtract(incoming);
+    effects.modifiesGlobals = modified.intersects(globals);
+    effects.returnsGlobals = returned.intersects(globals);
+    return effects;
+}
+
+} // namespace vypr
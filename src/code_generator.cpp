@@ -1,4 +1,7 @@
 #include "code_generator.h"
+#include "type_profile.h"
+#include "value_range.h"
+#include <cstdio>
 #include <iostream>
 #include <map>
 #include <stdexcept>
@@ -21,6 +24,7 @@ CodeGenerator::CodeGenerator(bool verbose) : verbose(verbose) {
     opcodeHandlers[IROpCode::ARRAY_SET] = &CodeGenerator::handleArraySet;
     opcodeHandlers[IROpCode::MEMBER_GET] = &CodeGenerator::handleMemberGet;
     opcodeHandlers[IROpCode::CONVERT] = &CodeGenerator::handleConvert;
+    opcodeHandlers[IROpCode::UNPACK] = &CodeGenerator::handleUnpack;
     opcodeHandlers[IROpCode::NOP] = &CodeGenerator::handleNop;
 }
 
@@ -40,7 +44,19 @@ void CodeGenerator::generate(const std::vector<IRFunction>& functions, const std
     
     // Write functions
     for (const auto& function : functions) {
+        // Merged functions share the definition of the function they alias
+        if (!function.aliasOf.empty()) {
+            writeAlias(function);
+            continue;
+        }
+        
         writeFunction(function);
+        
+        // Rebind the name so every call, including recursive ones, is timed
+        if (!latencyReportFile.empty()) {
+            outFile << function.name << " = _vypr_timed(" << pythonStringLiteral(function.name) << ")(" << function.name
+                    << ")\n\n";
+        }
     }
     
     // Add main execution if there is a __main__ function
@@ -56,6 +72,14 @@ void CodeGenerator::generate(const std::vector<IRFunction>& functions, const std
     }
 }
 
+void CodeGenerator::enableLatencyInstrumentation(const std::string& reportFile) {
+    latencyReportFile = reportFile;
+}
+
+void CodeGenerator::enableTypeProfiling(const std::string& profileFile) {
+    typeProfileFile = profileFile;
+}
+
 void CodeGenerator::writeHeader() {
     outFile << "#!/usr/bin/env python3\n";
     outFile << "# Generated by Vypr Compiler\n\n";
@@ -73,6 +97,121 @@ void CodeGenerator::writeHeader() {
     outFile << "        sys.stdout.write(prompt)\n";
     outFile << "        sys.stdout.flush()\n";
     outFile << "    return input()\n\n";
+    
+    if (!latencyReportFile.empty()) {
+        writeLatencyRuntime();
+    }
+    if (!typeProfileFile.empty()) {
+        writeTypeProfileRuntime();
+    }
+}
+
+void CodeGenerator::writeLatencyRuntime() {
+    // Per-function histograms with power-of-two nanosecond buckets. Self time
+    // subtracts the time spent in timed callees.
+    outFile << "# Latency instrumentation\n";
+    outFile << "import atexit\n";
+    outFile << "import json\n";
+    outFile << "import time\n\n";
+    
+    outFile << "_vypr_latency = {}\n";
+    outFile << "_vypr_callee_ns = []\n\n";
+    
+    outFile << "def _vypr_timed(name):\n";
+    outFile << "    stats = _vypr_latency.setdefault(name, {\"calls\": 0, \"total_ns\": 0, \"self_ns\": 0,\n";
+    outFile << "                                             \"total_hist\": [0] * 64, \"self_hist\": [0] * 64})\n";
+    outFile << "    def wrap(fn):\n";
+    outFile << "        def timed(*args):\n";
+    outFile << "            _vypr_callee_ns.append(0)\n";
+    outFile << "            start = time.perf_counter_ns()\n";
+    outFile << "            try:\n";
+    outFile << "                return fn(*args)\n";
+    outFile << "            finally:\n";
+    outFile << "                elapsed = time.perf_counter_ns() - start\n";
+    outFile << "                own = elapsed - _vypr_callee_ns.pop()\n";
+    outFile << "                if _vypr_callee_ns:\n";
+    outFile << "                    _vypr_callee_ns[-1] += elapsed\n";
+    outFile << "                stats[\"calls\"] += 1\n";
+    outFile << "                stats[\"total_ns\"] += elapsed\n";
+    outFile << "                stats[\"self_ns\"] += own\n";
+    outFile << "                stats[\"total_hist\"][min(elapsed.bit_length(), 63)] += 1\n";
+    outFile << "                stats[\"self_hist\"][min(max(own, 0).bit_length(), 63)] += 1\n";
+    outFile << "        timed.__name__ = fn.__name__\n";
+    outFile << "        timed.__wrapped__ = fn\n";
+    outFile << "        return timed\n";
+    outFile << "    return wrap\n\n";
+    
+    // Percentiles report the upper bound of the bucket they fall into
+    outFile << "def _vypr_percentile(hist, calls, fraction):\n";
+    outFile << "    rank = max(1, int(calls * fraction + 0.999999))\n";
+    outFile << "    seen = 0\n";
+    outFile << "    for bucket, count in enumerate(hist):\n";
+    outFile << "        seen += count\n";
+    outFile << "        if seen >= rank:\n";
+    outFile << "            return (1 << bucket) - 1 if bucket else 0\n";
+    outFile << "    return 0\n\n";
+    
+    outFile << "def _vypr_write_latency():\n";
+    outFile << "    report = {}\n";
+    outFile << "    for name, stats in _vypr_latency.items():\n";
+    outFile << "        calls = stats[\"calls\"]\n";
+    outFile << "        if not calls:\n";
+    outFile << "            continue\n";
+    outFile << "        report[name] = {\n";
+    outFile << "            \"calls\": calls,\n";
+    outFile << "            \"total_ns\": stats[\"total_ns\"],\n";
+    outFile << "            \"self_ns\": stats[\"self_ns\"],\n";
+    outFile << "            \"p50_ns\": _vypr_percentile(stats[\"total_hist\"], calls, 0.50),\n";
+    outFile << "            \"p99_ns\": _vypr_percentile(stats[\"total_hist\"], calls, 0.99),\n";
+    outFile << "            \"self_p50_ns\": _vypr_percentile(stats[\"self_hist\"], calls, 0.50),\n";
+    outFile << "            \"self_p99_ns\": _vypr_percentile(stats[\"self_hist\"], calls, 0.99),\n";
+    outFile << "        }\n";
+    outFile << "    with open(" << pythonStringLiteral(latencyReportFile) << ", \"w\") as f:\n";
+    outFile << "        json.dump(report, f, indent=2)\n\n";
+    
+    outFile << "atexit.register(_vypr_write_latency)\n\n";
+}
+
+void CodeGenerator::writeTypeProfileRuntime() {
+    // Counts per site and operand type signature, in the format read by
+    // TypeProfile::load
+    outFile << "# Type profiling\n";
+    outFile << "import atexit\n\n";
+    
+    outFile << "_vypr_types = {}\n\n";
+    
+    outFile << "def _vypr_observe(site, what, *values):\n";
+    outFile << "    key = (site, what, \",\".join([type(v).__name__ for v in values]))\n";
+    outFile << "    _vypr_types[key] = _vypr_types.get(key, 0) + 1\n\n";
+    
+    outFile << "def _vypr_write_types():\n";
+    outFile << "    with open(" << pythonStringLiteral(typeProfileFile) << ", \"w\") as f:\n";
+    outFile << "        f.write(\"# site\\twhat\\ttypes\\tcount\\n\")\n";
+    outFile << "        for (site, what, types), count in sorted(_vypr_types.items()):\n";
+    outFile << "            f.write(\"%s\\t%s\\t%s\\t%d\\n\" % (site, what, types, count))\n\n";
+    
+    outFile << "atexit.register(_vypr_write_types)\n\n";
+}
+
+std::string CodeGenerator::observeTypes(const IRFunction& function, size_t index) const {
+    const auto& instr = function.instructions[index];
+    std::string site = pythonStringLiteral(TypeProfile::siteId(function.name, index));
+    if (instr.opcode == IROpCode::BINARY_OP) {
+        return "_vypr_observe(" + site + ", " + pythonStringLiteral(instr.operands[2]) + ", " + instr.operands[1] +
+               ", " + instr.operands[3] + ")";
+    }
+    std::string args = instr.operands.size() > 2 ? instr.operands[2] : "";
+    return "_vypr_observe(" + site + ", " + pythonStringLiteral(instr.operands[1]) + (args.empty() ? "" : ", " + args) + ")";
+}
+
+void CodeGenerator::writeAlias(const IRFunction& function) {
+    if (latencyReportFile.empty()) {
+        outFile << function.name << " = " << function.aliasOf << "\n\n";
+    } else {
+        // Calls through the alias are still reported under its own name
+        outFile << function.name << " = _vypr_timed(" << pythonStringLiteral(function.name) << ")(" << function.aliasOf
+                << ".__wrapped__)\n\n";
+    }
 }
 
 void CodeGenerator::writeFunction(const IRFunction& function) {
@@ -106,8 +245,27 @@ void CodeGenerator::writeFunction(const IRFunction& function) {
         outFile << getIndent(2) << "pass # Empty function\n";
         outFile << getIndent(2) << "break\n";
     } else {
+        size_t count = function.instructions.size();
+
+        // int() of a value the range analysis proved to be an int is a copy
+        std::vector<bool> plainCopy(count, false);
+        bool converts = false;
+        for (const auto& instr : function.instructions) {
+            converts = converts || (instr.opcode == IROpCode::CONVERT && instr.operands[1] == "int");
+        }
+        if (converts) {
+            ControlFlowGraph cfg(function);
+            ValueRangeAnalysis ranges(cfg);
+            IntRange range;
+            for (size_t i = 0; i < count; ++i) {
+                const auto& instr = function.instructions[i];
+                plainCopy[i] = instr.opcode == IROpCode::CONVERT && instr.operands[1] == "int" &&
+                               ranges.operandRange(i, instr.operands[2], range);
+            }
+        }
+
         // Generate if/elif chain for instruction dispatch (only if instructions exist)
-        for (size_t i = 0; i < function.instructions.size(); ++i) {
+        for (size_t i = 0; i < count; ++i) {
             const auto& instr = function.instructions[i];
             std::string current_block_indent = getIndent(2); // Indentation for if/elif _pc == N:
             std::string current_code_indent = getIndent(3); // Indentation for code inside the block
@@ -122,6 +280,10 @@ void CodeGenerator::writeFunction(const IRFunction& function) {
             // Generate code based on opcode
             bool pc_increment_handled = false; // Track if jump/return handles _pc update
 
+            if (!typeProfileFile.empty() && (instr.opcode == IROpCode::BINARY_OP || instr.opcode == IROpCode::CALL)) {
+                outFile << current_code_indent << observeTypes(function, i) << "\n";
+            }
+
             switch (instr.opcode) {
                 case IROpCode::LABEL:
                     outFile << current_code_indent << "# LABEL " << instr.operands[0] << "\n";
@@ -169,11 +331,7 @@ void CodeGenerator::writeFunction(const IRFunction& function) {
                 }
     
                 case IROpCode::RETURN:
-                    if (instr.operands.empty()) {
-                        outFile << current_code_indent << "return\n";
-                    } else {
-                        outFile << current_code_indent << "return " << instr.operands[0] << "\n";
-                    }
+                    outFile << current_code_indent << handleReturn(instr) << "\n";
                     outFile << current_code_indent << "break # Exit loop after return\n";
                     pc_increment_handled = true;
                     break;
@@ -190,7 +348,14 @@ void CodeGenerator::writeFunction(const IRFunction& function) {
                 case IROpCode::ARRAY_GET:  outFile << current_code_indent << handleArrayGet(instr) << "\n"; break;
                 case IROpCode::ARRAY_SET:  outFile << current_code_indent << handleArraySet(instr) << "\n"; break;
                 case IROpCode::MEMBER_GET: outFile << current_code_indent << handleMemberGet(instr) << "\n"; break;
-                case IROpCode::CONVERT:    outFile << current_code_indent << handleConvert(instr) << "\n"; break;
+                case IROpCode::CONVERT:
+                    if (plainCopy[i]) {
+                        outFile << current_code_indent << instr.operands[0] << " = " << instr.operands[2] << "\n";
+                    } else {
+                        outFile << current_code_indent << handleConvert(instr) << "\n";
+                    }
+                    break;
+                case IROpCode::UNPACK:     outFile << current_code_indent << handleUnpack(instr) << "\n"; break;
                 case IROpCode::NOP:        outFile << current_code_indent << handleNop(instr) << "\n"; break;
 
                 default:
@@ -304,7 +469,8 @@ std::string CodeGenerator::handleReturn(const IRInstruction& instruction) {
     if (instruction.operands.empty()) {
         return "return";
     } else {
-        return "return " + instruction.operands[0];
+        // Several operands are returned as a Python tuple
+        return "return " + joinOperandList(instruction.operands);
     }
 }
 
@@ -363,6 +529,13 @@ std::string CodeGenerator::handleConvert(const IRInstruction& instruction) {
     return result + " = " + python_type + "(" + source + ")";
 }
 
+std::string CodeGenerator::handleUnpack(const IRInstruction& instruction) {
+    std::string source = instruction.operands[0];
+    std::vector<std::string> targets(instruction.operands.begin() + 1, instruction.operands.end());
+    
+    return joinOperandList(targets) + " = " + source;
+}
+
 std::string CodeGenerator::handleNop([[maybe_unused]] const IRInstruction& instruction) {
     return "pass";
 }
@@ -371,6 +544,31 @@ std::string CodeGenerator::getIndent(int level) const {
     return std::string(level * 4, ' ');
 }
 
+std::string CodeGenerator::pythonStringLiteral(const std::string& text) const {
+    std::string literal = "\"";
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c == '\\' || c == '"') {
+            literal += '\\';
+            literal += ch;
+        } else if (c == '\n') {
+            literal += "\\n";
+        } else if (c == '\r') {
+            literal += "\\r";
+        } else if (c == '\t') {
+            literal += "\\t";
+        } else if (c < 0x20 || c == 0x7f) {
+            // Other control characters would end or corrupt the literal; bytes >= 0x80 pass through as UTF-8
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\x%02x", c);
+            literal += buffer;
+        } else {
+            literal += ch;
+        }
+    }
+    return literal + "\"";
+}
+
 std::string CodeGenerator::getPythonOperator(TokenType op) const {
     switch (op) {
         case TokenType::PLUS: return "+";
@@ -4,6 +4,7 @@
 #include <sstream>
 #include <filesystem>
 #include <cstring>
+#include <cctype>
 #include "exceptions.h"
 #include "parser.h"
 #include "lexer.h"
@@ -11,7 +12,7 @@
 
 namespace vypr {
 
-Compiler::Compiler(bool verbose) : verbose(verbose) {
+Compiler::Compiler(bool verbose, const CompilerOptions& options) : verbose(verbose), options(options) {
     if (verbose) {
         std::cout << "Compiler initialized in verbose mode\n";
     }
@@ -79,12 +80,87 @@ void Compiler::compile(const std::string& source, const std::string& output_file
             std::cout << "\n";
         }
         
+        // Optimization
+        if (verbose) {
+            std::cout << "=== Optimization ===\n";
+        }
+        if (options.optimize) {
+            IROptimizer optimizer(verbose, options.budget);
+            optimizer.optimize(functions);
+            for (const auto& remark : optimizer.getRemarks()) {
+                std::cerr << "Remark: " << remark << "\n";
+            }
+        }
+        
+        if (verbose) {
+            std::cout << "Optimized IR:\n";
+            for (const auto& function : functions) {
+                std::cout << "  Function: " << function.name;
+                if (!function.aliasOf.empty()) {
+                    std::cout << " (alias of " << function.aliasOf << ")";
+                }
+                std::cout << "\n";
+                for (size_t i = 0; i < function.instructions.size(); ++i) {
+                    std::cout << "    " << i << ": " << function.instructions[i].toString() << "\n";
+                }
+            }
+            std::cout << "\n";
+        }
+        
         // Code Generation
         if (verbose) {
             std::cout << "=== Code Generation ===\n";
         }
+        if (options.target == Target::PYEXT) {
+            if (options.instrument_latency) {
+                throw CodeGenError("--instrument=latency is only supported by the python target");
+            }
+            if (options.instrument_types) {
+                throw CodeGenError("--instrument=types is only supported by the python target");
+            }
+            
+            // The module name must be a C and Python identifier
+            std::string module_name = std::filesystem::path(output_file).filename().string();
+            for (auto& c : module_name) {
+                if (!std::isalnum(static_cast<unsigned char>(c))) {
+                    c = '_';
+                }
+            }
+            if (module_name.empty() || std::isdigit(static_cast<unsigned char>(module_name[0]))) {
+                module_name = "_" + module_name;
+            }
+            
+            PyExtGenerator ext_gen(verbose);
+            TypeProfile profile;
+            if (!options.profile_file.empty()) {
+                profile.load(options.profile_file);
+                ext_gen.useTypeProfile(profile, std::filesystem::absolute(output_file + ".guards.json").string());
+            }
+            std::string c_file = output_file + ".c";
+            ext_gen.generate(functions, module_name, c_file);
+            extension_file = ext_gen.build(c_file, (std::filesystem::path(output_file).parent_path() / module_name).string());
+            
+            if (verbose) {
+                std::cout << "=== Output Files ===\n";
+                std::cout << "Generated files:\n";
+                std::cout << "  - " << c_file << "\n";
+                std::cout << "  - " << extension_file << "\n";
+            }
+            return;
+        }
+        
+        if (!options.profile_file.empty()) {
+            throw CodeGenError("--profile is only supported by the pyext target");
+        }
+        
         CodeGenerator code_gen(verbose);
         std::string py_file = output_file + ".py";
+        if (options.instrument_latency) {
+            code_gen.enableLatencyInstrumentation(std::filesystem::absolute(output_file + ".latency.json").string());
+        }
+        if (options.instrument_types) {
+            code_gen.enableTypeProfiling(std::filesystem::absolute(output_file + ".typeprof").string());
+        }
         code_gen.generate(functions, py_file);
         
         // Write output batch file
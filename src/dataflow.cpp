@@ -0,0 +1,552 @@
+#include "dataflow.h"
+#include "exceptions.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+
+namespace vypr {
+
+BitVector::BitVector(size_t size, bool value)
+    : bits(size), words((size + 63) / 64, value ? ~std::uint64_t(0) : 0) {
+    // Keep the bits past the end clear so whole words compare equal
+    if (value && size % 64 != 0) {
+        words.back() = (std::uint64_t(1) << (size % 64)) - 1;
+    }
+}
+
+bool BitVector::unionWith(const BitVector& other) {
+    std::uint64_t changed = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        std::uint64_t merged = words[i] | other.words[i];
+        changed |= merged ^ words[i];
+        words[i] = merged;
+    }
+    return changed != 0;
+}
+
+bool BitVector::intersectWith(const BitVector& other) {
+    std::uint64_t changed = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        std::uint64_t merged = words[i] & other.words[i];
+        changed |= merged ^ words[i];
+        words[i] = merged;
+    }
+    return changed != 0;
+}
+
+bool BitVector::subtract(const BitVector& other) {
+    std::uint64_t changed = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        std::uint64_t merged = words[i] & ~other.words[i];
+        changed |= merged ^ words[i];
+        words[i] = merged;
+    }
+    return changed != 0;
+}
+
+bool BitVector::intersects(const BitVector& other) const {
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (words[i] & other.words[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t BitVector::count() const {
+    size_t total = 0;
+    for (std::uint64_t word : words) {
+        while (word) {
+            word &= word - 1;
+            ++total;
+        }
+    }
+    return total;
+}
+
+size_t NameTable::intern(const std::string& name) {
+    auto [it, inserted] = ids.emplace(name, names.size());
+    if (inserted) {
+        names.push_back(name);
+    }
+    return it->second;
+}
+
+long NameTable::find(const std::string& name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? -1 : static_cast<long>(it->second);
+}
+
+ControlFlowGraph::ControlFlowGraph(const IRFunction& function) : source(&function) {
+    const auto& code = function.instructions;
+    owner.assign(code.size(), 0);
+    useStart.push_back(0);
+    defStart.push_back(0);
+    symbols.reserve(code.size());
+    for (const auto& instr : code) {
+        for (const auto& name : irUsedNames(instr)) {
+            useIds.push_back(symbols.intern(name));
+        }
+        for (const auto& name : irDefinedNames(instr)) {
+            defIds.push_back(symbols.intern(name));
+        }
+        useStart.push_back(useIds.size());
+        defStart.push_back(defIds.size());
+    }
+    if (code.empty()) {
+        nodes.push_back({0, 0, {}, {}});
+        order.push_back(0);
+        return;
+    }
+
+    std::vector<bool> leader(code.size(), false);
+    std::unordered_map<std::string, size_t> labels;
+    leader[0] = true;
+    for (size_t i = 0; i < code.size(); ++i) {
+        IROpCode op = code[i].opcode;
+        if (op == IROpCode::LABEL) {
+            leader[i] = true;
+            labels[code[i].operands[0]] = i;
+        } else if ((op == IROpCode::JUMP || op == IROpCode::JUMP_IF_FALSE || op == IROpCode::JUMP_IF_TRUE ||
+                    op == IROpCode::RETURN) && i + 1 < code.size()) {
+            leader[i + 1] = true;
+        }
+    }
+
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (leader[i]) {
+            if (!nodes.empty()) {
+                nodes.back().end = i;
+            }
+            nodes.push_back({i, code.size(), {}, {}});
+        }
+        owner[i] = nodes.size() - 1;
+    }
+
+    auto target = [&](const std::string& label) {
+        auto it = labels.find(label);
+        if (it == labels.end()) {
+            throw IRError("Undefined label '" + label + "' in function '" + function.name + "'");
+        }
+        return owner[it->second];
+    };
+    for (size_t b = 0; b < nodes.size(); ++b) {
+        const IRInstruction& last = code[nodes[b].end - 1];
+        std::vector<size_t>& successors = nodes[b].successors;
+        bool fallsThrough = nodes[b].end < code.size();
+        if (last.opcode == IROpCode::JUMP) {
+            successors.push_back(target(last.operands[0]));
+            fallsThrough = false;
+        } else if (last.opcode == IROpCode::JUMP_IF_FALSE || last.opcode == IROpCode::JUMP_IF_TRUE) {
+            successors.push_back(target(last.operands[1]));
+        } else if (last.opcode == IROpCode::RETURN) {
+            fallsThrough = false;
+        }
+        if (fallsThrough && std::find(successors.begin(), successors.end(), b + 1) == successors.end()) {
+            successors.push_back(b + 1);
+        }
+        for (size_t s : successors) {
+            nodes[s].predecessors.push_back(b);
+        }
+    }
+
+    // Iterative depth-first search; blocks are emitted in postorder
+    std::vector<bool> seen(nodes.size(), false);
+    std::vector<std::pair<size_t, size_t>> stack = {{0, 0}};
+    seen[0] = true;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < nodes[block].successors.size()) {
+            size_t s = nodes[block].successors[next++];
+            if (!seen[s]) {
+                seen[s] = true;
+                stack.push_back({s, 0});
+            }
+        } else {
+            order.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+}
+
+DataflowResult solveDataflow(const ControlFlowGraph& cfg, const DataflowProblem& problem) {
+    const auto& blocks = cfg.blocks();
+    bool forward = problem.direction == DataflowDirection::FORWARD;
+    bool intersect = problem.meet == DataflowMeet::INTERSECTION;
+
+    DataflowResult result;
+    result.in.assign(blocks.size(), BitVector(problem.domain, intersect));
+    result.out.assign(blocks.size(), BitVector(problem.domain, intersect));
+
+    std::vector<size_t> order = cfg.reversePostorder();
+    if (!forward) {
+        std::reverse(order.begin(), order.end());
+    }
+    const size_t unreachable = std::numeric_limits<size_t>::max();
+    std::vector<size_t> rank(blocks.size(), unreachable);
+    for (size_t k = 0; k < order.size(); ++k) {
+        rank[order[k]] = k;
+    }
+
+    // Pending blocks are visited in order, sweeping again until none is left
+    std::vector<bool> pending(blocks.size(), false);
+    size_t left = order.size();
+    for (size_t b : order) {
+        pending[b] = true;
+    }
+    while (left > 0) {
+        for (size_t b : order) {
+            if (!pending[b]) {
+                continue;
+            }
+            pending[b] = false;
+            --left;
+            ++result.visits;
+
+            const auto& from = forward ? blocks[b].predecessors : blocks[b].successors;
+            const auto& to = forward ? blocks[b].successors : blocks[b].predecessors;
+            const auto& flowing = forward ? result.out : result.in;
+            bool atBoundary = forward ? b == 0 : blocks[b].successors.empty();
+
+            BitVector value = atBoundary ? problem.boundary : BitVector(problem.domain, intersect);
+            for (size_t p : from) {
+                if (rank[p] == unreachable) {
+                    continue;
+                }
+                if (intersect) {
+                    value.intersectWith(flowing[p]);
+                } else {
+                    value.unionWith(flowing[p]);
+                }
+            }
+
+            BitVector transferred = value;
+            transferred.subtract(problem.kill[b]);
+            transferred.unionWith(problem.gen[b]);
+            (forward ? result.in[b] : result.out[b]) = std::move(value);
+
+            BitVector& produced = forward ? result.out[b] : result.in[b];
+            if (transferred != produced) {
+                produced = std::move(transferred);
+                for (size_t s : to) {
+                    if (rank[s] != unreachable && !pending[s]) {
+                        pending[s] = true;
+                        ++left;
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Names referenced in more than one block, or in a block that loops to
+// itself; only these can carry facts across block boundaries
+struct CrossBlockNames {
+    NameTable table;
+    std::vector<long> id;  // CFG name id -> id in `table`, -1 if untracked
+};
+
+static CrossBlockNames crossBlockNames(const ControlFlowGraph& cfg) {
+    const size_t none = std::numeric_limits<size_t>::max();
+    std::vector<size_t> firstBlock(cfg.names().size(), none);
+    std::vector<bool> crossing(cfg.names().size(), false);
+    for (size_t b = 0; b < cfg.blocks().size(); ++b) {
+        const BasicBlock& block = cfg.blocks()[b];
+        bool selfLoop = std::find(block.successors.begin(), block.successors.end(), b) != block.successors.end();
+        auto note = [&](size_t name) {
+            if (firstBlock[name] == none) {
+                firstBlock[name] = b;
+            }
+            if (selfLoop || firstBlock[name] != b) {
+                crossing[name] = true;
+            }
+        };
+        for (size_t i = block.begin; i < block.end; ++i) {
+            for (size_t name : cfg.uses(i)) note(name);
+            for (size_t name : cfg.defs(i)) note(name);
+        }
+    }
+
+    // Interned in order of first appearance so ids are deterministic
+    CrossBlockNames names;
+    names.id.assign(cfg.names().size(), -1);
+    for (size_t name = 0; name < cfg.names().size(); ++name) {
+        if (crossing[name]) {
+            names.id[name] = static_cast<long>(names.table.intern(cfg.names().name(name)));
+        }
+    }
+    return names;
+}
+
+static DataflowProblem emptyProblem(const ControlFlowGraph& cfg, size_t domain, DataflowDirection direction,
+                                    DataflowMeet meet) {
+    DataflowProblem problem;
+    problem.direction = direction;
+    problem.meet = meet;
+    problem.domain = domain;
+    problem.gen.assign(cfg.blocks().size(), BitVector(domain));
+    problem.kill.assign(cfg.blocks().size(), BitVector(domain));
+    problem.boundary = BitVector(domain);
+    return problem;
+}
+
+DataflowFacts computeLiveness(const ControlFlowGraph& cfg) {
+    DataflowFacts facts;
+    CrossBlockNames tracked = crossBlockNames(cfg);
+    facts.domain = std::move(tracked.table);
+    DataflowProblem problem = emptyProblem(cfg, facts.domain.size(), DataflowDirection::BACKWARD, DataflowMeet::UNION);
+
+    // Uses not preceded by a definition in the block are live on entry
+    for (size_t b = 0; b < cfg.blocks().size(); ++b) {
+        for (size_t i = cfg.blocks()[b].begin; i < cfg.blocks()[b].end; ++i) {
+            for (size_t name : cfg.uses(i)) {
+                long id = tracked.id[name];
+                if (id >= 0 && !problem.kill[b].test(id)) {
+                    problem.gen[b].set(id);
+                }
+            }
+            for (size_t name : cfg.defs(i)) {
+                long id = tracked.id[name];
+                if (id >= 0) {
+                    problem.kill[b].set(id);
+                }
+            }
+        }
+    }
+
+    facts.result = solveDataflow(cfg, problem);
+    return facts;
+}
+
+DataflowFacts computeReachingDefinitions(const ControlFlowGraph& cfg) {
+    const auto& blocks = cfg.blocks();
+    DataflowFacts facts;
+    CrossBlockNames variables = crossBlockNames(cfg);
+
+    // Only the last definition of a variable in a block can leave the block
+    std::vector<std::vector<std::pair<size_t, size_t>>> lastDefinitions(blocks.size());  // (Variable, domain id)
+    std::vector<std::vector<size_t>> definitionsOf(variables.table.size());
+    std::vector<size_t> last(variables.table.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            for (size_t name : cfg.defs(i)) {
+                if (variables.id[name] >= 0) {
+                    last[variables.id[name]] = i;
+                }
+            }
+        }
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            for (size_t name : cfg.defs(i)) {
+                long variable = variables.id[name];
+                if (variable >= 0 && last[variable] == i) {
+                    size_t id = facts.domain.intern(cfg.names().name(name) + "@" + std::to_string(i));
+                    definitionsOf[variable].push_back(id);
+                    facts.definitions.push_back(i);
+                    lastDefinitions[b].push_back({static_cast<size_t>(variable), id});
+                }
+            }
+        }
+    }
+
+    // A definition kills all others of its variable. Variables with many
+    // definitions kill through a cached mask, so building a kill set costs at
+    // most one pass over the words of the domain per variable.
+    size_t domain = facts.domain.size();
+    DataflowProblem problem = emptyProblem(cfg, domain, DataflowDirection::FORWARD, DataflowMeet::UNION);
+    std::unordered_map<size_t, BitVector> masks;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (const auto& [variable, definition] : lastDefinitions[b]) {
+            const auto& ids = definitionsOf[variable];
+            if (ids.size() > domain / 64) {
+                auto it = masks.find(variable);
+                if (it == masks.end()) {
+                    BitVector mask(domain);
+                    for (size_t id : ids) {
+                        mask.set(id);
+                    }
+                    it = masks.emplace(variable, std::move(mask)).first;
+                }
+                problem.kill[b].unionWith(it->second);
+            } else {
+                for (size_t id : ids) {
+                    problem.kill[b].set(id);
+                }
+            }
+            problem.gen[b].set(definition);
+        }
+    }
+
+    facts.result = solveDataflow(cfg, problem);
+    return facts;
+}
+
+DataflowFacts computeAvailableExpressions(const ControlFlowGraph& cfg) {
+    const auto& code = cfg.function().instructions;
+    const auto& blocks = cfg.blocks();
+
+    // Expressions are keyed by the variables and constants they are computed
+    // from, looking through the loads of the block. An event either computes
+    // an expression or assigns a variable.
+    struct Event {
+        bool computes;
+        std::string text;  // Expression key or assigned variable
+    };
+    std::vector<std::vector<Event>> events(blocks.size());
+    std::map<std::string, std::set<std::string>> operandsOf;  // Expression -> variables it reads
+    std::map<std::string, std::set<size_t>> blocksOf;         // Expression -> blocks computing it
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        std::unordered_map<std::string, std::string> keyOf;              // Temp -> expression key
+        std::unordered_map<std::string, std::set<std::string>> readsOf;  // Temp -> variables in its key
+        std::unordered_map<std::string, std::vector<std::string>> readers;  // Variable -> temps reading it
+        auto key = [&](const std::string& operand) {
+            auto it = keyOf.find(operand);
+            return it != keyOf.end() ? it->second : operand;
+        };
+        auto reads = [&](const std::string& operand) {
+            auto it = readsOf.find(operand);
+            if (it != readsOf.end()) {
+                return it->second;
+            }
+            return isIRName(operand) ? std::set<std::string>{operand} : std::set<std::string>();
+        };
+
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            const IRInstruction& instr = code[i];
+            std::string expression;
+            std::set<std::string> variables;
+            if (instr.opcode == IROpCode::LOAD_VAR) {
+                expression = instr.operands[1];
+                variables.insert(instr.operands[1]);
+            } else if (instr.opcode == IROpCode::LOAD_CONST) {
+                expression = "#" + instr.operands[1];
+            } else if (instr.opcode == IROpCode::BINARY_OP) {
+                expression = "(" + key(instr.operands[1]) + " " + instr.operands[2] + " " + key(instr.operands[3]) + ")";
+                variables = reads(instr.operands[1]);
+                for (const auto& v : reads(instr.operands[3])) variables.insert(v);
+            } else if (instr.opcode == IROpCode::UNARY_OP) {
+                expression = "(" + instr.operands[1] + key(instr.operands[2]) + ")";
+                variables = reads(instr.operands[2]);
+            }
+
+            if (instr.opcode == IROpCode::BINARY_OP || instr.opcode == IROpCode::UNARY_OP) {
+                events[b].push_back({true, expression});
+                operandsOf[expression] = variables;
+                blocksOf[expression].insert(b);
+            }
+
+            for (const auto& name : irDefinedNames(instr)) {
+                // Names computed from the old value no longer match their key
+                for (const auto& temp : readers[name]) {
+                    keyOf.erase(temp);
+                    readsOf.erase(temp);
+                }
+                readers[name].clear();
+                keyOf.erase(name);
+                readsOf.erase(name);
+                events[b].push_back({false, name});
+            }
+
+            const std::string result = expression.empty() ? "" : instr.operands[0];
+            if (!result.empty() && !variables.count(result)) {
+                keyOf[result] = expression;
+                readsOf[result] = variables;
+                for (const auto& v : variables) {
+                    readers[v].push_back(result);
+                }
+            }
+        }
+    }
+
+    // Only expressions computed in several blocks, or in a loop, can be reused
+    DataflowFacts facts;
+    std::map<std::string, std::vector<size_t>> killedBy;  // Variable -> expressions reading it
+    for (const auto& [expression, where] : blocksOf) {
+        size_t b = *where.begin();
+        const auto& successors = blocks[b].successors;
+        if (where.size() > 1 || std::find(successors.begin(), successors.end(), b) != successors.end()) {
+            size_t id = facts.domain.intern(expression);
+            for (const auto& variable : operandsOf[expression]) {
+                killedBy[variable].push_back(id);
+            }
+        }
+    }
+
+    DataflowProblem problem = emptyProblem(cfg, facts.domain.size(), DataflowDirection::FORWARD,
+                                           DataflowMeet::INTERSECTION);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (const auto& event : events[b]) {
+            if (event.computes) {
+                long id = facts.domain.find(event.text);
+                if (id >= 0) {
+                    problem.gen[b].set(id);
+                }
+                continue;
+            }
+            auto it = killedBy.find(event.text);
+            if (it == killedBy.end()) {
+                continue;
+            }
+            for (size_t id : it->second) {
+                problem.gen[b].reset(id);
+                problem.kill[b].set(id);
+            }
+        }
+    }
+
+    facts.result = solveDataflow(cfg, problem);
+    return facts;
+}
+
+DataflowFacts computeDefiniteInitialization(const ControlFlowGraph& cfg) {
+    const IRFunction& function = cfg.function();
+    DataflowFacts facts;
+    CrossBlockNames tracked = crossBlockNames(cfg);
+    facts.domain = std::move(tracked.table);
+    for (const auto& parameter : function.parameters) {
+        long name = cfg.names().find(parameter);
+        size_t id = facts.domain.intern(parameter);
+        if (name >= 0) {
+            tracked.id[name] = static_cast<long>(id);
+        }
+    }
+
+    DataflowProblem problem = emptyProblem(cfg, facts.domain.size(), DataflowDirection::FORWARD,
+                                           DataflowMeet::INTERSECTION);
+    for (const auto& parameter : function.parameters) {
+        problem.boundary.set(facts.domain.find(parameter));
+    }
+    for (size_t b = 0; b < cfg.blocks().size(); ++b) {
+        for (size_t i = cfg.blocks()[b].begin; i < cfg.blocks()[b].end; ++i) {
+            for (size_t name : cfg.defs(i)) {
+                if (tracked.id[name] >= 0) {
+                    problem.gen[b].set(tracked.id[name]);
+                }
+            }
+        }
+    }
+
+    facts.result = solveDataflow(cfg, problem);
+    return facts;
+}
+
+bool isDefinitelyInitialized(const ControlFlowGraph& cfg, const DataflowFacts& facts, size_t index,
+                             const std::string& name) {
+    long symbol = cfg.names().find(name);
+    size_t b = cfg.blockOf(index);
+    for (size_t i = cfg.blocks()[b].begin; i < index; ++i) {
+        for (size_t defined : cfg.defs(i)) {
+            if (static_cast<long>(defined) == symbol) {
+                return true;
+            }
+        }
+    }
+    // Untracked names are only referenced in this block
+    long id = facts.domain.find(name);
+    return id >= 0 && facts.result.in[b].test(id);
+}
+
+} // namespace vypr
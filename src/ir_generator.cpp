@@ -1,6 +1,7 @@
 #include "ir_generator.h"
 #include <sstream>
 #include <variant>
+#include <cctype>
 
 namespace vypr {
 
@@ -55,6 +56,8 @@ void IRGenerator::visit(const std::shared_ptr<Program>& program) {
 void IRGenerator::visit(const StatementPtr& stmt) {
     if (auto varDecl = std::dynamic_pointer_cast<VarDeclarationStatement>(stmt)) {
         visitVarDeclaration(varDecl);
+    } else if (auto destructDecl = std::dynamic_pointer_cast<DestructuringDeclaration>(stmt)) {
+        visitDestructuringDeclaration(destructDecl);
     } else if (auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt)) {
         visitFunctionDeclaration(funcDecl);
     } else if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
@@ -115,6 +118,20 @@ void IRGenerator::visitVarDeclaration(const std::shared_ptr<VarDeclarationStatem
     variables[stmt->name] = 1;
 }
 
+void IRGenerator::visitDestructuringDeclaration(const std::shared_ptr<DestructuringDeclaration>& stmt) {
+    std::string source = visit(stmt->initializer);
+    
+    // UNPACK source, name1, name2, ...
+    std::vector<std::string> operands = {source};
+    operands.insert(operands.end(), stmt->names.begin(), stmt->names.end());
+    emit(IRInstruction(IROpCode::UNPACK, operands));
+    
+    // Track the variables
+    for (const auto& name : stmt->names) {
+        variables[name] = 1;
+    }
+}
+
 void IRGenerator::visitFunctionDeclaration(const std::shared_ptr<FunctionDeclaration>& stmt) {
     // Save current function
     IRFunction* previousFunction = currentFunction;
@@ -195,12 +212,12 @@ void IRGenerator::visitWhileStatement(const std::shared_ptr<WhileStatement>& stm
 }
 
 void IRGenerator::visitReturnStatement(const std::shared_ptr<ReturnStatement>& stmt) {
-    if (stmt->value != nullptr) {
-        std::string value = visit(stmt->value);
-        emit(IRInstruction(IROpCode::RETURN, {value}));
-    } else {
-        emit(IRInstruction(IROpCode::RETURN));
+    // Multiple values are returned as separate operands, not as an array
+    std::vector<std::string> values;
+    for (const auto& value : stmt->values) {
+        values.push_back(visit(value));
     }
+    emit(IRInstruction(IROpCode::RETURN, values));
 }
 
 void IRGenerator::visitBlockStatement(const std::shared_ptr<BlockStatement>& stmt) {
@@ -401,16 +418,8 @@ std::string IRGenerator::visitCallExpression(const std::shared_ptr<CallExpressio
     }
 
     // Handle regular function calls
-    std::string argsStr;
-    for (size_t i = 0; i < argValues.size(); ++i) {
-        if (i > 0) {
-            argsStr += ", ";
-        }
-        argsStr += argValues[i];
-    }
-    
     std::string result = generateTemp();
-    emit(IRInstruction(IROpCode::CALL, {result, callee_name, argsStr}));
+    emit(IRInstruction(IROpCode::CALL, {result, callee_name, joinOperandList(argValues)}));
     return result;
 }
 
@@ -422,17 +431,8 @@ std::string IRGenerator::visitArrayExpression(const std::shared_ptr<ArrayExpress
         elementValues.push_back(visit(element));
     }
     
-    // Join element values with commas
-    std::string elementsStr;
-    for (size_t i = 0; i < elementValues.size(); ++i) {
-        if (i > 0) {
-            elementsStr += ", ";
-        }
-        elementsStr += elementValues[i];
-    }
-    
     std::string result = generateTemp();
-    emit(IRInstruction(IROpCode::ARRAY_NEW, {result, elementsStr}));
+    emit(IRInstruction(IROpCode::ARRAY_NEW, {result, joinOperandList(elementValues)}));
     return result;
 }
 
@@ -473,9 +473,124 @@ std::string irOpCodeToString(IROpCode opcode) {
         case IROpCode::MEMBER_GET: return "MEMBER_GET";
         case IROpCode::LABEL: return "LABEL";
         case IROpCode::CONVERT: return "CONVERT";
+        case IROpCode::UNPACK: return "UNPACK";
         case IROpCode::NOP: return "NOP";
         default: return "UNKNOWN";
     }
 }
 
+std::vector<std::string> splitOperandList(const std::string& list) {
+    std::vector<std::string> items;
+    std::string item;
+    std::stringstream ss(list);
+    
+    while (std::getline(ss, item, ',')) {
+        // Trim the space after each comma
+        size_t first = item.find_first_not_of(' ');
+        size_t last = item.find_last_not_of(' ');
+        if (first != std::string::npos) {
+            items.push_back(item.substr(first, last - first + 1));
+        }
+    }
+    
+    return items;
+}
+
+std::string joinOperandList(const std::vector<std::string>& items) {
+    std::string list;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i > 0) {
+            list += ", ";
+        }
+        list += items[i];
+    }
+    return list;
+}
+
+bool isIRName(const std::string& operand) {
+    if (operand.empty() || !(std::isalpha(static_cast<unsigned char>(operand[0])) || operand[0] == '_')) {
+        return false;
+    }
+    return operand != "true" && operand != "false";
+}
+
+std::vector<std::string> irDefinedNames(const IRInstruction& instruction) {
+    switch (instruction.opcode) {
+        case IROpCode::LOAD_CONST:
+        case IROpCode::LOAD_VAR:
+        case IROpCode::STORE_VAR:
+        case IROpCode::BINARY_OP:
+        case IROpCode::UNARY_OP:
+        case IROpCode::CALL:
+        case IROpCode::INPUT:
+        case IROpCode::ARRAY_NEW:
+        case IROpCode::ARRAY_GET:
+        case IROpCode::MEMBER_GET:
+        case IROpCode::CONVERT:
+            return {instruction.operands[0]};
+        case IROpCode::UNPACK:
+            return std::vector<std::string>(instruction.operands.begin() + 1, instruction.operands.end());
+        default:
+            return {};
+    }
+}
+
+std::vector<std::string> irUsedNames(const IRInstruction& instruction) {
+    const auto& ops = instruction.operands;
+    std::vector<std::string> candidates;
+    
+    switch (instruction.opcode) {
+        case IROpCode::LOAD_VAR:
+        case IROpCode::STORE_VAR:
+            candidates = {ops[1]};
+            break;
+        case IROpCode::BINARY_OP:
+            candidates = {ops[1], ops[3]};
+            break;
+        case IROpCode::UNARY_OP:
+        case IROpCode::CONVERT:
+            candidates = {ops[2]};
+            break;
+        case IROpCode::JUMP_IF_FALSE:
+        case IROpCode::JUMP_IF_TRUE:
+        case IROpCode::PRINT:
+        case IROpCode::UNPACK:
+            candidates = {ops[0]};
+            break;
+        case IROpCode::RETURN:
+            candidates = ops;
+            break;
+        case IROpCode::CALL:
+            if (ops.size() > 2) {
+                candidates = splitOperandList(ops[2]);
+            }
+            break;
+        case IROpCode::ARRAY_NEW:
+            if (ops.size() > 1) {
+                candidates = splitOperandList(ops[1]);
+            }
+            break;
+        case IROpCode::ARRAY_GET:
+        case IROpCode::MEMBER_GET:
+            candidates = {ops[1]};
+            if (instruction.opcode == IROpCode::ARRAY_GET) {
+                candidates.push_back(ops[2]);
+            }
+            break;
+        case IROpCode::ARRAY_SET:
+            candidates = ops;
+            break;
+        default:
+            break;
+    }
+    
+    std::vector<std::string> names;
+    for (const auto& candidate : candidates) {
+        if (isIRName(candidate)) {
+            names.push_back(candidate);
+        }
+    }
+    return names;
+}
+
 } // namespace vypr 
\ No newline at end of file
@@ -0,0 +1,1199 @@
+#include "ir_optimizer.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <cctype>
+
+namespace vypr {
+
+// Instructions without side effects that a loop condition may consist of
+static bool isPureOp(IROpCode opcode) {
+    return opcode == IROpCode::LOAD_CONST || opcode == IROpCode::LOAD_VAR || opcode == IROpCode::BINARY_OP ||
+           opcode == IROpCode::UNARY_OP || opcode == IROpCode::MEMBER_GET;
+}
+
+// Label a jump goes to, or nullptr for other instructions
+static const std::string* jumpTarget(const IRInstruction& instr) {
+    switch (instr.opcode) {
+        case IROpCode::JUMP:
+            return &instr.operands[0];
+        case IROpCode::JUMP_IF_FALSE:
+        case IROpCode::JUMP_IF_TRUE:
+            return &instr.operands[1];
+        default:
+            return nullptr;
+    }
+}
+
+// Replace operands found in `renames`, including inside operand lists
+static void renameOperands(IRInstruction& instr, const std::unordered_map<std::string, std::string>& renames) {
+    for (size_t k = 0; k < instr.operands.size(); ++k) {
+        auto rename = [&](std::string& operand) {
+            auto it = renames.find(operand);
+            if (it != renames.end()) {
+                operand = it->second;
+            }
+        };
+        if ((instr.opcode == IROpCode::CALL && k == 2) || (instr.opcode == IROpCode::ARRAY_NEW && k == 1)) {
+            auto items = splitOperandList(instr.operands[k]);
+            for (auto& item : items) {
+                rename(item);
+            }
+            instr.operands[k] = joinOperandList(items);
+        } else {
+            rename(instr.operands[k]);
+        }
+    }
+}
+
+// Match a counter initialization `var = start` occupying [begin, end)
+static bool matchCounterInit(const std::vector<IRInstruction>& code, size_t begin, size_t end, const std::string& var) {
+    if (end == begin + 1) {
+        return code[begin].opcode == IROpCode::LOAD_CONST && code[begin].operands[0] == var;
+    }
+    if (end != begin + 2) {
+        return false;
+    }
+    const auto& value = code[begin];
+    const auto& store = code[begin + 1];
+    return store.opcode == IROpCode::STORE_VAR && store.operands[0] == var &&
+           (value.opcode == IROpCode::LOAD_CONST || value.opcode == IROpCode::LOAD_VAR) &&
+           value.operands[0] == store.operands[1];
+}
+
+// Match a counter step `var = var + c`, c a positive integer, that ends at
+// `end` and starts no earlier than `begin`. Sets the counter and the start.
+static bool matchCounterStep(const std::vector<IRInstruction>& code, size_t begin, size_t end,
+                             std::string& var, size_t& start) {
+    if (end <= begin || code[end - 1].opcode != IROpCode::STORE_VAR) {
+        return false;
+    }
+    var = code[end - 1].operands[0];
+    std::string sum = code[end - 1].operands[1];
+    std::unordered_set<std::string> needed;
+    const IRInstruction* add = nullptr;
+
+    // Walk back over the computation of the new value; the generator may
+    // also leave dead loads of the counter in front of it
+    start = end - 1;
+    while (start > begin) {
+        const IRInstruction& instr = code[start - 1];
+        if (instr.opcode == IROpCode::LOAD_VAR && instr.operands[1] == var) {
+            // Counter reads
+        } else if (instr.opcode == IROpCode::LOAD_CONST && needed.count(instr.operands[0])) {
+            // Step constant
+        } else if (instr.opcode == IROpCode::BINARY_OP && !add && instr.operands[0] == sum && instr.operands[2] == "+") {
+            add = &instr;
+            needed.insert(instr.operands[1]);
+            needed.insert(instr.operands[3]);
+        } else {
+            break;
+        }
+        start--;
+    }
+    if (!add) {
+        return false;
+    }
+
+    auto resolve = [&](const std::string& operand) {
+        for (size_t k = start; k < end; ++k) {
+            if ((code[k].opcode == IROpCode::LOAD_VAR || code[k].opcode == IROpCode::LOAD_CONST) &&
+                code[k].operands[0] == operand) {
+                return code[k].operands[1];
+            }
+        }
+        return operand;
+    };
+    std::string left = resolve(add->operands[1]);
+    std::string right = resolve(add->operands[3]);
+    if (right == var) {
+        std::swap(left, right);
+    }
+    return left == var && !right.empty() && right.size() < 10 && right != "0" &&
+           std::all_of(right.begin(), right.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+}
+
+IROptimizer::IROptimizer(bool verbose, const OptimizationBudget& budget) : verbose(verbose), budget(budget) {
+    // Passes run in this order on every function
+    passes.push_back({"scalar-replacement", &IROptimizer::scalarReplaceArrays});
+    passes.push_back({"loop-interchange", &IROptimizer::interchangeLoops});
+    passes.push_back({"lookup-hoisting", &IROptimizer::hoistInvariantLookups});
+
+    // Module passes run in this order once the functions are optimized
+    modulePasses.push_back({"function-merging", &IROptimizer::mergeIdenticalFunctions});
+}
+
+void IROptimizer::optimize(std::vector<IRFunction>& functions) {
+    remarks.clear();
+    totalMeter = {Clock::now(), 0};
+
+    // Function passes preserve behaviour, so the summaries stay valid
+    // throughout. They are budgeted like a pass; without them calls have
+    // unknown effects.
+    size_t skipped = 0;
+    bool exhausted = false;
+    std::unique_ptr<ArraySummaries> arraySummaries;
+    try {
+        passMeter = {Clock::now(), 0};
+        arraySummaries = std::make_unique<ArraySummaries>(functions, [this](size_t work) { charge(work); });
+    } catch (const BudgetExceeded& e) {
+        exhausted = e.total;
+        if (!e.total) {
+            remarks.push_back("array summaries skipped: they exceeded the " + std::string(e.what()));
+            log(remarks.back());
+        }
+    }
+    summaries = arraySummaries.get();
+    for (auto& function : functions) {
+        if (!function.aliasOf.empty()) {
+            continue;
+        }
+        if (exhausted) {
+            skipped++;
+            continue;
+        }
+
+        // Keep the generated IR to fall back to if the passes run out of budget
+        std::vector<IRInstruction> original = function.instructions;
+        functionMeter = {Clock::now(), 0};
+        inFunction = true;
+        std::string running;
+        try {
+            for (const auto& [name, pass] : passes) {
+                running = name;
+                passMeter = {Clock::now(), 0};
+                charge(0);
+                if ((this->*pass)(function)) {
+                    log(name + " changed " + function.name);
+                }
+            }
+        } catch (const BudgetExceeded& e) {
+            function.instructions = std::move(original);
+            if (e.total) {
+                exhausted = true;
+                skipped++;
+            } else {
+                remarks.push_back("function '" + function.name + "' left unoptimized (-O0): " + running + " exceeded the " +
+                                  e.what());
+                log(remarks.back());
+            }
+        }
+        inFunction = false;
+    }
+    summaries = nullptr;
+
+    // Module passes see every function at once, so going over budget undoes
+    // the pass as a whole
+    for (const auto& [name, pass] : modulePasses) {
+        if (exhausted) {
+            break;
+        }
+        std::vector<IRFunction> original = functions;
+        try {
+            passMeter = {Clock::now(), 0};
+            charge(0);
+            if ((this->*pass)(functions)) {
+                log(name + " changed the module");
+            }
+        } catch (const BudgetExceeded& e) {
+            functions = std::move(original);
+            if (e.total) {
+                exhausted = true;
+            } else {
+                remarks.push_back(name + " skipped: it exceeded the " + std::string(e.what()));
+                log(remarks.back());
+            }
+        }
+    }
+
+    if (exhausted) {
+        std::string message = "the optimizer ran out of its total budget";
+        if (skipped > 0) {
+            message += "; " + std::to_string(skipped) + " function" + (skipped == 1 ? "" : "s") + " left unoptimized (-O0)";
+        }
+        remarks.push_back(message);
+        log(remarks.back());
+    }
+}
+
+// Account for `work` instructions scanned by the running pass and stop it
+// once it, its function or the whole optimization is over budget
+void IROptimizer::charge(size_t work) {
+    passMeter.work += work;
+    functionMeter.work += work;
+    totalMeter.work += work;
+    Clock::time_point now = Clock::now();
+
+    auto check = [&](const Meter& meter, const char* scope, double milliseconds, size_t limit, bool total) {
+        if (limit > 0 && meter.work > limit) {
+            throw BudgetExceeded(std::string(scope) + " work budget of " + std::to_string(limit) + " instructions", total);
+        }
+        std::chrono::duration<double, std::milli> elapsed = now - meter.start;
+        if (milliseconds > 0 && elapsed.count() > milliseconds) {
+            std::ostringstream message;
+            message << scope << " time budget of " << milliseconds << " ms";
+            throw BudgetExceeded(message.str(), total);
+        }
+    };
+    check(passMeter, "per-pass", budget.passMilliseconds, budget.passWork, false);
+    if (inFunction) {
+        check(functionMeter, "per-function", budget.functionMilliseconds, budget.functionWork, false);
+    }
+    check(totalMeter, "total", budget.totalMilliseconds, budget.totalWork, true);
+}
+
+// Replace arrays that are created by ARRAY_NEW, never escape and are only
+// indexed with constants by one scalar per element:
+//
+//   ARRAY_NEW t2, t0, t1      STORE_VAR p_0, t0
+//   STORE_VAR p, t2      =>   STORE_VAR p_1, t1
+//   LOAD_VAR t4, p            LOAD_CONST t5, 1
+//   LOAD_CONST t5, 1          LOAD_VAR t6, p_1
+//   ARRAY_GET t6, t4, t5
+bool IROptimizer::scalarReplaceArrays(IRFunction& function) {
+    auto& code = function.instructions;
+    charge(code.size());
+
+    // Index definitions and uses of every name
+    std::unordered_map<std::string, int> defCount;
+    std::unordered_map<std::string, size_t> defSite;
+    std::unordered_map<std::string, std::vector<size_t>> useSites;
+    std::unordered_set<std::string> taken;
+
+    for (const auto& param : function.parameters) {
+        defCount[param]++;
+        taken.insert(param);
+    }
+    for (size_t i = 0; i < code.size(); ++i) {
+        for (const auto& def : irDefinedNames(code[i])) {
+            defCount[def]++;
+            defSite[def] = i;
+            taken.insert(def);
+        }
+        for (const auto& use : irUsedNames(code[i])) {
+            useSites[use].push_back(i);
+            taken.insert(use);
+        }
+    }
+
+    auto usesOf = [&](const std::string& name) -> const std::vector<size_t>& {
+        static const std::vector<size_t> none;
+        auto it = useSites.find(name);
+        return it == useSites.end() ? none : it->second;
+    };
+
+    // Resolve an index operand to a non-negative integer constant
+    auto constantIndex = [&](const std::string& operand, size_t& value) -> bool {
+        std::string literal = operand;
+        if (isIRName(operand)) {
+            if (defCount[operand] != 1 || code[defSite[operand]].opcode != IROpCode::LOAD_CONST) {
+                return false;
+            }
+            literal = code[defSite[operand]].operands[1];
+        }
+        if (literal.empty() || literal.size() > 9) {
+            return false;
+        }
+        for (char c : literal) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) {
+                return false;
+            }
+        }
+        value = std::stoul(literal);
+        return true;
+    };
+
+    auto elementsOf = [&](size_t alloc) {
+        const auto& ops = code[alloc].operands;
+        return ops.size() > 1 ? splitOperandList(ops[1]) : std::vector<std::string>();
+    };
+
+    // An aggregate is either an ARRAY_NEW temp used directly, or a variable
+    // whose every definition stores a fresh ARRAY_NEW temp
+    struct Aggregate {
+        std::string name;
+        size_t length;
+        std::vector<size_t> allocs;      // ARRAY_NEW instructions
+        std::vector<size_t> stores;      // STORE_VAR var, temp
+        std::vector<std::string> handles; // Names the array is accessed through
+    };
+    std::vector<Aggregate> candidates;
+    std::map<std::string, Aggregate> variables;
+
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].opcode != IROpCode::ARRAY_NEW) {
+            continue;
+        }
+        const std::string& temp = code[i].operands[0];
+        if (defCount[temp] != 1) {
+            continue;
+        }
+
+        const auto& uses = usesOf(temp);
+        if (uses.size() == 1 && code[uses[0]].opcode == IROpCode::STORE_VAR &&
+            code[uses[0]].operands[1] == temp && code[uses[0]].operands[0] != temp) {
+            Aggregate& var = variables[code[uses[0]].operands[0]];
+            var.name = code[uses[0]].operands[0];
+            var.allocs.push_back(i);
+            var.stores.push_back(uses[0]);
+        } else {
+            candidates.push_back({temp, elementsOf(i).size(), {i}, {}, {temp}});
+        }
+    }
+
+    for (auto& [name, var] : variables) {
+        // Every definition must be one of the array stores
+        if (defCount[name] != static_cast<int>(var.stores.size())) {
+            continue;
+        }
+
+        var.length = elementsOf(var.allocs[0]).size();
+        bool valid = true;
+        for (size_t alloc : var.allocs) {
+            valid = valid && elementsOf(alloc).size() == var.length;
+        }
+
+        // The variable may only be read into single-use handle temps that are
+        // consumed before anything can redefine the variable
+        auto redefines = [&](const IRInstruction& instr) {
+            auto defs = irDefinedNames(instr);
+            return std::find(defs.begin(), defs.end(), name) != defs.end();
+        };
+        for (size_t use : usesOf(name)) {
+            if (!valid) {
+                break;
+            }
+            const auto& instr = code[use];
+            if (instr.opcode != IROpCode::LOAD_VAR || defCount[instr.operands[0]] != 1) {
+                valid = false;
+                break;
+            }
+            const std::string& handle = instr.operands[0];
+            size_t last = use;
+            for (size_t handleUse : usesOf(handle)) {
+                last = std::max(last, handleUse);
+            }
+            for (size_t j = use + 1; j < last && valid; ++j) {
+                IROpCode op = code[j].opcode;
+                if (op == IROpCode::LABEL || op == IROpCode::JUMP || op == IROpCode::JUMP_IF_FALSE ||
+                    op == IROpCode::JUMP_IF_TRUE || op == IROpCode::RETURN || redefines(code[j])) {
+                    valid = false;
+                }
+            }
+            var.handles.push_back(handle);
+        }
+
+        if (valid) {
+            candidates.push_back(var);
+        }
+    }
+
+    // Check that every access goes through a handle with a constant, in-range index
+    std::map<size_t, std::vector<IRInstruction>> rewrites;
+    bool changed = false;
+
+    for (const auto& aggregate : candidates) {
+        std::vector<std::string> scalars;
+        for (size_t e = 0; e < aggregate.length; ++e) {
+            scalars.push_back(generateName(aggregate.name + "_" + std::to_string(e), taken));
+        }
+
+        std::map<size_t, std::vector<IRInstruction>> local;
+        bool escapes = false;
+
+        for (const auto& handle : aggregate.handles) {
+            for (size_t use : usesOf(handle)) {
+                const auto& instr = code[use];
+                const auto& ops = instr.operands;
+                size_t index = 0;
+
+                if (instr.opcode == IROpCode::ARRAY_GET && ops[1] == handle && ops[2] != handle &&
+                    constantIndex(ops[2], index) && index < aggregate.length) {
+                    local[use] = {IRInstruction(IROpCode::LOAD_VAR, {ops[0], scalars[index]})};
+                } else if (instr.opcode == IROpCode::ARRAY_SET && ops[0] == handle && ops[1] != handle &&
+                           ops[2] != handle && constantIndex(ops[1], index) && index < aggregate.length) {
+                    local[use] = {IRInstruction(IROpCode::STORE_VAR, {scalars[index], ops[2]})};
+                } else if (instr.opcode == IROpCode::MEMBER_GET && ops[2] == "length") {
+                    local[use] = {IRInstruction(IROpCode::LOAD_CONST, {ops[0], std::to_string(aggregate.length)})};
+                } else {
+                    escapes = true;
+                    break;
+                }
+            }
+            if (escapes) {
+                break;
+            }
+            // Handle loads of a variable disappear along with the array
+            if (handle != aggregate.name) {
+                local[defSite[handle]] = {};
+            }
+        }
+
+        if (escapes) {
+            continue;
+        }
+
+        // Construction becomes one store per element
+        for (size_t alloc : aggregate.allocs) {
+            std::vector<IRInstruction> stores;
+            auto elements = elementsOf(alloc);
+            for (size_t e = 0; e < elements.size(); ++e) {
+                stores.push_back(IRInstruction(IROpCode::STORE_VAR, {scalars[e], elements[e]}));
+            }
+            local[alloc] = stores;
+        }
+        for (size_t store : aggregate.stores) {
+            local[store] = {};
+        }
+
+        rewrites.insert(local.begin(), local.end());
+        changed = true;
+        log("  replaced array '" + aggregate.name + "' with " + std::to_string(aggregate.length) + " scalars");
+    }
+
+    if (!changed) {
+        return false;
+    }
+
+    std::vector<IRInstruction> result;
+    result.reserve(code.size());
+    for (size_t i = 0; i < code.size(); ++i) {
+        auto it = rewrites.find(i);
+        if (it == rewrites.end()) {
+            result.push_back(code[i]);
+        } else {
+            result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    }
+    code = std::move(result);
+    return true;
+}
+
+// Interchange perfectly nested loops whose body walks an array of arrays
+// against its layout, so the inner loop runs along a row:
+//
+//   var i = 0                       var j = 0
+//   while i < cols:                 while j < rows:
+//       var j = 0                       var i = 0
+//       while j < rows:       =>        while i < cols:
+//           m[j][i] = m[j][i] * 2           m[j][i] = m[j][i] * 2
+//           j = j + 1                       i = i + 1
+//       i = i + 1                       j = j + 1
+//
+// Both counters must start from an invariant, step by a positive constant,
+// be tested only against invariants and not be used outside the nest. The
+// body must be straight-line code without calls or I/O that only writes
+// array elements and scalars private to one iteration, and indexes arrays
+// directly with the counters or invariants. A dependence test on those
+// subscripts then decides whether the new iteration order is legal; arrays
+// reached through different variables must not share storage, and no
+// written row may be the array it was taken from.
+bool IROptimizer::interchangeLoops(IRFunction& function) {
+    auto& code = function.instructions;
+
+    auto attempt = [&]() -> bool {
+        charge(code.size());
+        auto loops = findLoops(function);
+
+        // Instructions that define or read each name, in order
+        std::unordered_map<std::string, std::vector<size_t>> refs;
+        for (size_t k = 0; k < code.size(); ++k) {
+            for (const auto& name : irDefinedNames(code[k])) {
+                refs[name].push_back(k);
+            }
+            for (const auto& name : irUsedNames(code[k])) {
+                refs[name].push_back(k);
+            }
+        }
+        auto within = [&](const std::string& name, size_t begin, size_t end) {
+            for (size_t k : refs[name]) {
+                if (k < begin || k >= end) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        for (const auto& outer : loops) {
+            for (const auto& inner : loops) {
+                charge(1);
+                if (inner.head <= outer.test || inner.exit >= outer.latch) {
+                    continue;
+                }
+
+                // Perfect nest: outer test, inner counter init, inner loop, outer step
+                std::string i, j;
+                size_t outerStep, innerStep;
+                if (!matchCounterStep(code, inner.exit + 1, outer.latch, i, outerStep) || outerStep != inner.exit + 1 ||
+                    !matchCounterStep(code, inner.test + 1, inner.latch, j, innerStep) || i == j ||
+                    !matchCounterInit(code, outer.test + 1, inner.head, j)) {
+                    continue;
+                }
+                size_t outerInit;
+                if (outer.head >= 2 && matchCounterInit(code, outer.head - 2, outer.head, i)) {
+                    outerInit = outer.head - 2;
+                } else if (outer.head >= 1 && matchCounterInit(code, outer.head - 1, outer.head, i)) {
+                    outerInit = outer.head - 1;
+                } else {
+                    continue;
+                }
+                size_t nestEnd = outer.exit + 1;
+                if (!within(i, outerInit, nestEnd) || !within(j, outerInit, nestEnd)) {
+                    continue;
+                }
+
+                // Every name the nest does not define is invariant in it
+                std::unordered_set<std::string> defined;
+                for (size_t k = outerInit; k < nestEnd; ++k) {
+                    for (const auto& def : irDefinedNames(code[k])) {
+                        defined.insert(def);
+                    }
+                }
+
+                // The pieces that move must be self-contained: apart from the
+                // counters, what one defines is only read by itself
+                std::vector<std::pair<size_t, size_t>> pieces = {
+                    {outerInit, outer.head}, {outer.head + 1, outer.test + 1}, {outer.test + 1, inner.head},
+                    {inner.head + 1, inner.test + 1}, {inner.test + 1, innerStep}, {innerStep, inner.latch},
+                    {outerStep, outer.latch}};
+                bool valid = true;
+                for (const auto& [begin, end] : pieces) {
+                    for (size_t k = begin; k < end && valid; ++k) {
+                        for (const auto& def : irDefinedNames(code[k])) {
+                            valid = valid && (def == i || def == j || within(def, begin, end));
+                        }
+                    }
+                }
+
+                // Tests and inits read only their own counter and invariants
+                auto readsInvariants = [&](size_t begin, size_t end, const std::string& counter) {
+                    for (size_t k = begin; k < end; ++k) {
+                        for (const auto& use : irUsedNames(code[k])) {
+                            if (use != counter && defined.count(use) && !within(use, begin, end)) {
+                                return false;
+                            }
+                        }
+                    }
+                    return true;
+                };
+                valid = valid && readsInvariants(outerInit, outer.head, "") &&
+                        readsInvariants(outer.head + 1, outer.test, i) &&
+                        readsInvariants(outer.test + 1, inner.head, "") &&
+                        readsInvariants(inner.head + 1, inner.test, j);
+                if (!valid) {
+                    continue;
+                }
+
+                // Classify the body: subscripts are the outer counter (@outer),
+                // the inner counter (@inner), a literal (#) or an invariant ($)
+                struct Access {
+                    std::string root;
+                    std::vector<std::string> path;  // Subscripts from the root variable
+                    bool write;
+                    std::string temp;               // Result of a read
+                    size_t at;                      // The ARRAY_GET or ARRAY_SET
+                };
+                std::vector<Access> accesses;
+                std::unordered_map<std::string, std::string> subscripts;
+                std::unordered_map<std::string, std::vector<std::string>> paths;
+                std::unordered_map<std::string, std::string> roots;
+                size_t bodyBegin = inner.test + 1;
+
+                for (size_t k = bodyBegin; k < innerStep && valid; ++k) {
+                    const auto& instr = code[k];
+                    const auto& ops = instr.operands;
+                    switch (instr.opcode) {
+                        case IROpCode::LOAD_VAR:
+                            if (ops[1] == i) {
+                                subscripts[ops[0]] = "@outer";
+                            } else if (ops[1] == j) {
+                                subscripts[ops[0]] = "@inner";
+                            } else if (!defined.count(ops[1])) {
+                                subscripts[ops[0]] = "$" + ops[1];
+                                paths[ops[0]] = {};
+                                roots[ops[0]] = ops[1];
+                            } else {
+                                // Scalars written in the body must be private to an iteration
+                                valid = within(ops[1], bodyBegin, innerStep) &&
+                                        !irDefinedNames(code[refs[ops[1]].front()]).empty() &&
+                                        code[refs[ops[1]].front()].operands[0] == ops[1];
+                            }
+                            break;
+                        case IROpCode::LOAD_CONST:
+                            subscripts[ops[0]] = "#" + ops[1];
+                            break;
+                        case IROpCode::ARRAY_GET:
+                        case IROpCode::ARRAY_SET: {
+                            bool get = instr.opcode == IROpCode::ARRAY_GET;
+                            const std::string& base = get ? ops[1] : ops[0];
+                            const std::string& index = get ? ops[2] : ops[1];
+                            auto subscript = isIRName(index) ? subscripts.find(index) : subscripts.end();
+                            if (!paths.count(base) || (isIRName(index) && subscript == subscripts.end())) {
+                                valid = false;
+                                break;
+                            }
+                            std::vector<std::string> path = paths[base];
+                            path.push_back(isIRName(index) ? subscript->second : "#" + index);
+                            if (path.size() > 2 || (!get && path.size() != 2)) {
+                                valid = false;
+                                break;
+                            }
+                            if (get) {
+                                paths[ops[0]] = path;
+                                roots[ops[0]] = roots[base];
+                            }
+                            accesses.push_back({roots[base], path, !get, get ? ops[0] : "", k});
+                            break;
+                        }
+                        case IROpCode::STORE_VAR:
+                            valid = ops[0] != i && ops[0] != j;
+                            break;
+                        case IROpCode::BINARY_OP:
+                        case IROpCode::UNARY_OP:
+                        case IROpCode::MEMBER_GET:
+                        case IROpCode::CONVERT:
+                            break;
+                        default:
+                            valid = false;
+                            break;
+                    }
+                }
+                if (!valid) {
+                    continue;
+                }
+
+                // Reads that only fetch a row to index further are not element reads
+                auto rowOnly = [&](const std::string& temp) {
+                    for (size_t k : refs[temp]) {
+                        const auto& instr = code[k];
+                        const auto& ops = instr.operands;
+                        bool def = instr.opcode == IROpCode::ARRAY_GET && ops[0] == temp;
+                        bool base = (instr.opcode == IROpCode::ARRAY_GET && ops[1] == temp && ops[2] != temp) ||
+                                    (instr.opcode == IROpCode::ARRAY_SET && ops[0] == temp && ops[1] != temp && ops[2] != temp) ||
+                                    (instr.opcode == IROpCode::MEMBER_GET && ops[1] == temp);
+                        if (!def && !base) {
+                            return false;
+                        }
+                    }
+                    return true;
+                };
+
+                using Element = std::pair<std::string, std::vector<std::string>>;  // (Root, subscripts)
+                std::vector<Element> elements;
+                std::vector<Element> writes;
+                std::vector<size_t> stores;
+                int against = 0;
+                int along = 0;
+                for (const auto& access : accesses) {
+                    if (access.path == std::vector<std::string>{"@inner", "@outer"}) {
+                        against++;
+                    } else if (access.path == std::vector<std::string>{"@outer", "@inner"}) {
+                        along++;
+                    }
+                    if (access.write) {
+                        writes.push_back({access.root, access.path});
+                        elements.push_back({access.root, access.path});
+                        stores.push_back(access.at);
+                    } else if (!rowOnly(access.temp)) {
+                        // A row read as a whole may hold any element of the array
+                        elements.push_back({access.root, access.path.size() == 2
+                                                             ? access.path
+                                                             : std::vector<std::string>{"*", "*"}});
+                    }
+                }
+                if (against <= along) {
+                    continue;
+                }
+
+                // Accesses through different variables are independent only if
+                // the arrays reachable from them cannot overlap
+                std::unique_ptr<ArrayAliasAnalysis> aliases;
+                auto analysis = [&]() -> const ArrayAliasAnalysis& {
+                    if (!aliases) {
+                        aliases = std::make_unique<ArrayAliasAnalysis>(function, summaries, [this](size_t work) { charge(work); });
+                    }
+                    return *aliases;
+                };
+                for (const auto& write : writes) {
+                    for (const auto& other : elements) {
+                        if (write.first != other.first) {
+                            valid = valid && !analysis().mayShare(write.first, other.first);
+                        }
+                    }
+                }
+                // The subscripts describe rows and elements only if no row is the
+                // array itself; otherwise a store below a row replaces a row
+                for (size_t k = 0; k < stores.size() && valid; ++k) {
+                    valid = !analysis().mayModify(stores[k], writes[k].first);
+                }
+                if (!valid) {
+                    continue;
+                }
+
+                // Interchange is illegal if two accesses can touch the same element
+                // in iterations ordered differently by the two loops. Equal counter
+                // column subscripts pin that loop, which rules it out, and
+                // different constant columns never meet. Row subscripts prove
+                // nothing: two rows of one array can be the same list.
+                auto constantsDiffer = [](const std::string& a, const std::string& b) {
+                    auto digits = [](const std::string& s) {
+                        return s.size() > 1 && s.size() < 10 &&
+                               std::all_of(s.begin() + 1, s.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+                    };
+                    return digits(a) && digits(b) && std::stoi(a.substr(1)) != std::stoi(b.substr(1));
+                };
+                for (const auto& [root, write] : writes) {
+                    for (const auto& [otherRoot, other] : elements) {
+                        if (root != otherRoot) {
+                            continue;
+                        }
+                        bool pinned = write[1] == other[1] && write[1][0] == '@';
+                        valid = valid && (pinned || constantsDiffer(write[1], other[1]));
+                    }
+                }
+                if (!valid) {
+                    continue;
+                }
+
+                auto slice = [&](size_t begin, size_t end) {
+                    return std::vector<IRInstruction>(code.begin() + begin, code.begin() + end);
+                };
+                auto exitTo = [](std::vector<IRInstruction> test, const std::string& label) {
+                    test.back().operands[1] = label;
+                    return test;
+                };
+                const std::string& outerExit = code[outer.exit].operands[0];
+                const std::string& innerExit = code[inner.exit].operands[0];
+                auto taken = namesIn(function);
+                auto outerCounterInit = slice(outerInit, outer.head);
+                auto outerTest = slice(outer.head + 1, outer.test + 1);
+
+                std::vector<IRInstruction> nest;
+                auto append = [&](const std::vector<IRInstruction>& block) {
+                    nest.insert(nest.end(), block.begin(), block.end());
+                };
+                // The original outer test still runs first and skips the nest
+                append(cloneWithFreshNames(outerCounterInit, {i}, taken));
+                append(cloneWithFreshNames(outerTest, {i}, taken));
+                append(slice(outer.test + 1, inner.head));
+                nest.push_back(code[outer.head]);
+                append(exitTo(slice(inner.head + 1, inner.test + 1), outerExit));
+                append(outerCounterInit);
+                nest.push_back(code[inner.head]);
+                append(exitTo(outerTest, innerExit));
+                append(slice(bodyBegin, innerStep));
+                append(slice(outerStep, outer.latch));
+                nest.push_back(code[inner.latch]);
+                nest.push_back(code[inner.exit]);
+                append(slice(innerStep, inner.latch));
+                nest.push_back(code[outer.latch]);
+                nest.push_back(code[outer.exit]);
+
+                log("  interchanged loops over '" + i + "' and '" + j + "'");
+                code.erase(code.begin() + outerInit, code.begin() + nestEnd);
+                code.insert(code.begin() + outerInit, nest.begin(), nest.end());
+                return true;
+            }
+        }
+        return false;
+    };
+
+    bool changed = false;
+    while (attempt()) {
+        changed = true;
+    }
+    return changed;
+}
+
+// Hoist loop-invariant array lookups, such as the row fetch m[j] of m[j][i]
+// in a loop over i, in front of the loop:
+//
+//   LABEL L2                       <condition>
+//   <condition>                    JUMP_IF_FALSE t8_1, L3
+//   JUMP_IF_FALSE t8, L3           LOAD_VAR t11_1, m
+//   LOAD_VAR t11, m                LOAD_VAR t12_1, j
+//   LOAD_VAR t12, j          =>    ARRAY_GET t13_1, t11_1, t12_1
+//   ARRAY_GET t13, t11, t12        STORE_VAR m_row, t13_1
+//                                  LABEL L2
+//                                  <condition>
+//                                  JUMP_IF_FALSE t8, L3
+//                                  LOAD_VAR t13, m_row
+//
+// The condition is tested once in front of the loop so the lookup only runs
+// if the loop body would. Only lookups in the straight-line start of the body
+// move, and only if nothing in the loop can replace the row: either the loop
+// has no calls and no array stores, or the alias analysis shows that no store
+// or call in the loop writes the array the row is taken from. A store below a
+// row of the same array needs that proof too, since the row may be the array.
+bool IROptimizer::hoistInvariantLookups(IRFunction& function) {
+    auto& code = function.instructions;
+
+    auto attempt = [&]() -> bool {
+        charge(code.size());
+        std::unordered_map<std::string, std::vector<size_t>> defs;
+        std::unordered_map<std::string, int> useCount;
+        for (size_t k = 0; k < code.size(); ++k) {
+            for (const auto& def : irDefinedNames(code[k])) {
+                defs[def].push_back(k);
+            }
+            for (const auto& use : irUsedNames(code[k])) {
+                useCount[use]++;
+            }
+        }
+        auto singleDef = [&](const std::string& name, size_t& at) {
+            auto it = defs.find(name);
+            if (it == defs.end() || it->second.size() != 1) {
+                return false;
+            }
+            at = it->second[0];
+            return true;
+        };
+        std::unique_ptr<ArrayAliasAnalysis> aliases;
+        for (const auto& loop : findLoops(function)) {
+            charge(loop.exit - loop.head + 1);
+            std::unordered_set<std::string> assigned;
+            std::vector<size_t> writers;  // Stores and calls in the loop
+            for (size_t k = loop.head; k <= loop.latch; ++k) {
+                for (const auto& def : irDefinedNames(code[k])) {
+                    assigned.insert(def);
+                }
+                if (code[k].opcode == IROpCode::CALL || code[k].opcode == IROpCode::ARRAY_SET) {
+                    writers.push_back(k);
+                }
+            }
+            auto unwritten = [&](const std::string& array) {
+                if (!aliases) {
+                    aliases = std::make_unique<ArrayAliasAnalysis>(function, summaries, [this](size_t work) { charge(work); });
+                }
+                for (size_t k : writers) {
+                    if (aliases->mayModify(k, array)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            std::vector<size_t> candidates;
+            for (size_t k = loop.test + 1; k < loop.latch; ++k) {
+                IROpCode op = code[k].opcode;
+                if (op == IROpCode::LABEL || op == IROpCode::JUMP || op == IROpCode::JUMP_IF_FALSE ||
+                    op == IROpCode::JUMP_IF_TRUE || op == IROpCode::RETURN || op == IROpCode::PRINT ||
+                    op == IROpCode::INPUT || op == IROpCode::CALL) {
+                    break;
+                }
+                if (op != IROpCode::ARRAY_GET) {
+                    continue;
+                }
+
+                const auto& ops = code[k].operands;
+                size_t at, baseDef, indexDef;
+                if (!singleDef(ops[0], at) || !singleDef(ops[1], baseDef) || baseDef <= loop.test ||
+                    code[baseDef].opcode != IROpCode::LOAD_VAR || assigned.count(code[baseDef].operands[1])) {
+                    continue;
+                }
+                if (isIRName(ops[2]) &&
+                    (!singleDef(ops[2], indexDef) || indexDef <= loop.test ||
+                     (code[indexDef].opcode != IROpCode::LOAD_CONST &&
+                      (code[indexDef].opcode != IROpCode::LOAD_VAR || assigned.count(code[indexDef].operands[1]))))) {
+                    continue;
+                }
+                const std::string& array = code[baseDef].operands[1];
+                if (writers.empty() || unwritten(array)) {
+                    candidates.push_back(k);
+                }
+            }
+            if (candidates.empty()) {
+                continue;
+            }
+
+            auto taken = namesIn(function);
+            std::vector<IRInstruction> test(code.begin() + loop.head + 1, code.begin() + loop.test + 1);
+            std::vector<IRInstruction> preheader = cloneWithFreshNames(test, {}, taken);
+            std::map<size_t, IRInstruction> replaced;
+            std::unordered_set<size_t> dropped;
+            std::map<std::pair<std::string, std::string>, std::string> rows;  // (array, index) -> variable
+
+            for (size_t k : candidates) {
+                const auto& ops = code[k].operands;
+                size_t baseDef = defs[ops[1]][0];
+                std::string array = code[baseDef].operands[1];
+                std::string index = ops[2];
+                std::string indexKey = index;
+                if (isIRName(index)) {
+                    const auto& load = code[defs[index][0]];
+                    indexKey = (load.opcode == IROpCode::LOAD_VAR ? "$" : "#") + load.operands[1];
+                }
+
+                // Repeated lookups of the same element share one variable
+                std::string& row = rows[{array, indexKey}];
+                if (row.empty()) {
+                    std::string arrayTemp = generateName(ops[1], taken);
+                    preheader.push_back(IRInstruction(IROpCode::LOAD_VAR, {arrayTemp, array}));
+                    if (isIRName(index)) {
+                        IRInstruction load = code[defs[index][0]];
+                        load.operands[0] = generateName(index, taken);
+                        index = load.operands[0];
+                        preheader.push_back(load);
+                    }
+                    std::string rowTemp = generateName(ops[0], taken);
+                    row = generateName(array + "_row", taken);
+                    preheader.push_back(IRInstruction(IROpCode::ARRAY_GET, {rowTemp, arrayTemp, index}));
+                    preheader.push_back(IRInstruction(IROpCode::STORE_VAR, {row, rowTemp}));
+                    log("  hoisted lookup into '" + row + "' out of loop " + code[loop.head].operands[0]);
+                }
+                replaced.emplace(k, IRInstruction(IROpCode::LOAD_VAR, {ops[0], row}));
+
+                // Loads that only fed the lookup are no longer needed
+                if (useCount[ops[1]] == 1) {
+                    dropped.insert(baseDef);
+                }
+                if (isIRName(ops[2]) && useCount[ops[2]] == 1) {
+                    dropped.insert(defs[ops[2]][0]);
+                }
+            }
+
+            std::vector<IRInstruction> result(code.begin(), code.begin() + loop.head);
+            result.insert(result.end(), preheader.begin(), preheader.end());
+            for (size_t k = loop.head; k < code.size(); ++k) {
+                auto it = replaced.find(k);
+                if (it != replaced.end()) {
+                    result.push_back(it->second);
+                } else if (!dropped.count(k)) {
+                    result.push_back(code[k]);
+                }
+            }
+            code = std::move(result);
+            return true;
+        }
+        return false;
+    };
+
+    bool changed = false;
+    while (attempt()) {
+        changed = true;
+    }
+    return changed;
+}
+
+// Merge functions whose bodies are identical up to the names of parameters,
+// locals, temps and labels. The first one keeps the body, the others become
+// aliases of it. Merging repeats until nothing changes, since functions that
+// only differed in calling two now-merged functions become identical too.
+bool IROptimizer::mergeIdenticalFunctions(std::vector<IRFunction>& functions) {
+    std::unordered_map<std::string, std::string> aliases;
+    for (const auto& function : functions) {
+        if (!function.aliasOf.empty()) {
+            aliases[function.name] = function.aliasOf;
+        }
+    }
+
+    bool changed = false;
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        std::unordered_map<size_t, std::vector<size_t>> buckets;
+        std::vector<std::string> forms(functions.size());
+
+        for (size_t i = 0; i < functions.size(); ++i) {
+            IRFunction& function = functions[i];
+            if (function.name == "__main__" || !function.aliasOf.empty()) {
+                continue;
+            }
+            charge(function.instructions.size());
+            forms[i] = canonicalForm(function, aliases);
+
+            auto& bucket = buckets[std::hash<std::string>()(forms[i])];
+            auto same = std::find_if(bucket.begin(), bucket.end(), [&](size_t j) { return forms[j] == forms[i]; });
+            if (same == bucket.end()) {
+                bucket.push_back(i);
+                continue;
+            }
+
+            // Aliases always point at a function that has a body
+            const std::string& target = functions[*same].name;
+            for (auto& other : functions) {
+                if (other.aliasOf == function.name) {
+                    other.aliasOf = target;
+                    aliases[other.name] = target;
+                }
+            }
+            function.aliasOf = target;
+            function.instructions.clear();
+            aliases[function.name] = target;
+            merged = changed = true;
+            log("  merged '" + function.name + "' into '" + target + "'");
+        }
+    }
+    return changed;
+}
+
+// Structural form of a function body. Parameters, locals, temps and labels
+// are numbered in order of appearance, calls are resolved through aliases
+// and globals and literals are kept as they are.
+std::string IROptimizer::canonicalForm(const IRFunction& function,
+                                       const std::unordered_map<std::string, std::string>& aliases) const {
+    std::unordered_set<std::string> locals(function.parameters.begin(), function.parameters.end());
+    for (const auto& instr : function.instructions) {
+        for (const auto& def : irDefinedNames(instr)) {
+            locals.insert(def);
+        }
+    }
+
+    // '%' cannot start an identifier, so canonical names never collide with globals
+    std::unordered_map<std::string, std::string> names;
+    std::unordered_map<std::string, std::string> labels;
+    for (size_t i = 0; i < function.parameters.size(); ++i) {
+        names[function.parameters[i]] = "%p" + std::to_string(i);
+    }
+    auto name = [&](const std::string& operand) {
+        if (!locals.count(operand)) {
+            return operand;
+        }
+        return names.emplace(operand, "%v" + std::to_string(names.size())).first->second;
+    };
+
+    std::ostringstream form;
+    form << function.parameters.size() << "\n";
+    for (const auto& instr : function.instructions) {
+        IROpCode op = instr.opcode;
+        form << static_cast<int>(op);
+
+        for (size_t k = 0; k < instr.operands.size(); ++k) {
+            const std::string& operand = instr.operands[k];
+            form << ' ';
+            if (((op == IROpCode::LABEL || op == IROpCode::JUMP) && k == 0) ||
+                ((op == IROpCode::JUMP_IF_FALSE || op == IROpCode::JUMP_IF_TRUE) && k == 1)) {
+                form << labels.emplace(operand, "%l" + std::to_string(labels.size())).first->second;
+            } else if (op == IROpCode::CALL && k == 1) {
+                auto alias = aliases.find(operand);
+                std::string callee = alias == aliases.end() ? operand : alias->second;
+                form << (callee == function.name ? "%self" : callee);
+            } else if ((op == IROpCode::CALL && k == 2) || (op == IROpCode::ARRAY_NEW && k == 1)) {
+                std::vector<std::string> items;
+                for (const auto& item : splitOperandList(operand)) {
+                    items.push_back(name(item));
+                }
+                form << "[" << joinOperandList(items) << "]";
+            } else if ((op == IROpCode::LOAD_CONST && k == 1) || (op == IROpCode::BINARY_OP && k == 2) ||
+                       (op == IROpCode::UNARY_OP && k == 1) || (op == IROpCode::CONVERT && k == 1) ||
+                       (op == IROpCode::MEMBER_GET && k == 2)) {
+                form << operand;
+            } else {
+                form << name(operand);
+            }
+        }
+        form << "\n";
+    }
+    return form.str();
+}
+
+std::vector<IROptimizer::Loop> IROptimizer::findLoops(const IRFunction& function) {
+    const auto& code = function.instructions;
+    charge(code.size());
+    std::unordered_map<std::string, size_t> labels;
+    for (size_t k = 0; k < code.size(); ++k) {
+        if (code[k].opcode == IROpCode::LABEL) {
+            labels[code[k].operands[0]] = k;
+        }
+    }
+
+    std::vector<Loop> loops;
+    for (size_t latch = 0; latch + 1 < code.size(); ++latch) {
+        if (code[latch].opcode != IROpCode::JUMP || code[latch + 1].opcode != IROpCode::LABEL) {
+            continue;
+        }
+        auto head = labels.find(code[latch].operands[0]);
+        if (head == labels.end() || head->second >= latch) {
+            continue;
+        }
+        Loop loop{head->second, head->second + 1, latch, latch + 1};
+
+        // The condition is pure and ends in the exit test
+        while (loop.test < latch && isPureOp(code[loop.test].opcode)) {
+            loop.test++;
+        }
+        if (code[loop.test].opcode != IROpCode::JUMP_IF_FALSE ||
+            code[loop.test].operands[1] != code[loop.exit].operands[0]) {
+            continue;
+        }
+
+        // Entered only by falling into the head, left only through the exit
+        charge(code.size());
+        bool wellFormed = true;
+        for (size_t k = 0; k < code.size() && wellFormed; ++k) {
+            const std::string* label = jumpTarget(code[k]);
+            if (!label) {
+                continue;
+            }
+            auto target = labels.find(*label);
+            if (target == labels.end()) {
+                wellFormed = false;
+                break;
+            }
+            bool fromInside = k > loop.head && k <= loop.latch;
+            bool toInside = target->second > loop.head && target->second <= loop.latch;
+            if (target->second == loop.head) {
+                wellFormed = fromInside;
+            } else if (fromInside != toInside) {
+                wellFormed = fromInside && target->second == loop.exit;
+            }
+        }
+        if (wellFormed) {
+            loops.push_back(loop);
+        }
+    }
+    return loops;
+}
+
+// Copy a block, giving every name it defines (except `keep`) a fresh name
+std::vector<IRInstruction> IROptimizer::cloneWithFreshNames(const std::vector<IRInstruction>& block,
+                                                            const std::unordered_set<std::string>& keep,
+                                                            std::unordered_set<std::string>& taken) const {
+    std::unordered_map<std::string, std::string> renames;
+    for (const auto& instr : block) {
+        for (const auto& def : irDefinedNames(instr)) {
+            if (!keep.count(def) && !renames.count(def)) {
+                renames[def] = generateName(def, taken);
+            }
+        }
+    }
+    std::vector<IRInstruction> clone = block;
+    for (auto& instr : clone) {
+        renameOperands(instr, renames);
+    }
+    return clone;
+}
+
+std::unordered_set<std::string> IROptimizer::namesIn(const IRFunction& function) const {
+    std::unordered_set<std::string> names(function.parameters.begin(), function.parameters.end());
+    for (const auto& instr : function.instructions) {
+        for (const auto& def : irDefinedNames(instr)) {
+            names.insert(def);
+        }
+        for (const auto& use : irUsedNames(instr)) {
+            names.insert(use);
+        }
+    }
+    return names;
+}
+
+std::string IROptimizer::generateName(const std::string& base, std::unordered_set<std::string>& taken) const {
+    std::string name = base;
+    int suffix = 0;
+    while (taken.count(name)) {
+        name = base + "_" + std::to_string(++suffix);
+    }
+    taken.insert(name);
+    return name;
+}
+
+void IROptimizer::log(const std::string& message) const {
+    if (verbose) {
+        std::cout << message << "\n";
+    }
+}
+
+} // namespace vypr
@@ -23,7 +23,7 @@ std::unordered_map<std::string, TokenType> Lexer::keywords = {
 };
 
 Lexer::Lexer(const std::string& source)
-    : source(source), position(0), line(1), column(1), current_char('\0'), current_indent(0), at_line_start(true) {
+    : source(source), position(0), line(1), column(1), current_char('\0'), current_indent(0), at_line_start(true), last_relexed(0) {
     
     if (!source.empty()) {
         current_char = source[position];
@@ -32,20 +32,175 @@ Lexer::Lexer(const std::string& source)
 }
 
 std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
-    Token token = next_token();
+    tokens.clear();
+    checkpoints.clear();
     
-    while (token.type != TokenType::EOF_TOKEN) {
+    while (true) {
+        // Remember the state at every line start so relex() can resume here
+        if (at_checkpoint(checkpoints)) {
+            checkpoints.push_back({position, line, column, indent_stack, tokens.size()});
+        }
+        
+        Token token = next_token();
         tokens.push_back(token);
-        token = next_token();
+        
+        // Stop after the final EOF token
+        if (token.type == TokenType::EOF_TOKEN) {
+            break;
+        }
+    }
+    
+    last_relexed = tokens.size();
+    return tokens;
+}
+
+const std::vector<Token>& Lexer::relex(const SourceEdit& edit) {
+    if (edit.start < 0 || edit.old_length < 0 ||
+        static_cast<size_t>(edit.start) + edit.old_length > source.length()) {
+        throw LexerError("Invalid edit range at offset " + std::to_string(edit.start));
+    }
+    
+    source.replace(edit.start, edit.old_length, edit.new_text);
+    
+    // Nothing to resume from, lex the whole buffer
+    if (checkpoints.empty()) {
+        reset();
+        tokenize();
+        return tokens;
+    }
+    
+    // Find the nearest checkpoint at or before the edit. Text before it is
+    // unchanged, so every token before it is still valid.
+    size_t restart = 0;
+    while (restart + 1 < checkpoints.size() && checkpoints[restart + 1].position <= edit.start) {
+        restart++;
+    }
+    const size_t first_token = checkpoints[restart].token_index;
+    
+    const int delta = static_cast<int>(edit.new_text.length()) - edit.old_length;
+    const int edit_end = edit.start + static_cast<int>(edit.new_text.length());
+    
+    std::vector<Token> fresh;
+    std::vector<LexerCheckpoint> fresh_checkpoints;
+    size_t old_index = restart + 1;
+    bool synced = false;
+    
+    try {
+        restore(checkpoints[restart]);
+        
+        while (true) {
+            if (at_checkpoint(fresh_checkpoints)) {
+                // Past the edited text the old and new streams line up again
+                // once a line starts at the same shifted offset with the same
+                // indentation. The tokens at the end of the buffer are always
+                // relexed, their position depends on how the text ends.
+                if (position >= edit_end && position < static_cast<int>(source.length())) {
+                    int old_position = position - delta;
+                    while (old_index < checkpoints.size() && checkpoints[old_index].position < old_position) {
+                        old_index++;
+                    }
+                    if (old_index < checkpoints.size() &&
+                        checkpoints[old_index].position == old_position &&
+                        checkpoints[old_index].indent_stack == indent_stack) {
+                        synced = true;
+                        break;
+                    }
+                }
+                fresh_checkpoints.push_back({position, line, column, indent_stack, first_token + fresh.size()});
+            }
+            
+            Token token = next_token();
+            fresh.push_back(token);
+            
+            if (token.type == TokenType::EOF_TOKEN) {
+                break;
+            }
+        }
+    } catch (...) {
+        // The cache no longer matches the source, force a full lex next time
+        tokens.clear();
+        checkpoints.clear();
+        reset();
+        throw;
     }
     
-    // Add final EOF token
-    tokens.push_back(token);
+    last_relexed = fresh.size();
+    
+    if (!synced) {
+        // Relexed through to the end of the buffer
+        tokens.erase(tokens.begin() + first_token, tokens.end());
+        tokens.insert(tokens.end(), fresh.begin(), fresh.end());
+        checkpoints.erase(checkpoints.begin() + restart, checkpoints.end());
+        checkpoints.insert(checkpoints.end(), fresh_checkpoints.begin(), fresh_checkpoints.end());
+    } else {
+        // Splice the fresh tokens in and shift everything after the sync point
+        const LexerCheckpoint& sync = checkpoints[old_index];
+        const int line_delta = line - sync.line;
+        const size_t old_end = sync.token_index;
+        const long token_delta = static_cast<long>(fresh.size()) - static_cast<long>(old_end - first_token);
+        
+        if (line_delta != 0) {
+            for (size_t i = old_end; i < tokens.size(); ++i) {
+                tokens[i].line += line_delta;
+            }
+        }
+        for (size_t i = old_index; i < checkpoints.size(); ++i) {
+            checkpoints[i].position += delta;
+            checkpoints[i].line += line_delta;
+            checkpoints[i].token_index += token_delta;
+        }
+        
+        tokens.erase(tokens.begin() + first_token, tokens.begin() + old_end);
+        tokens.insert(tokens.begin() + first_token, fresh.begin(), fresh.end());
+        checkpoints.erase(checkpoints.begin() + restart, checkpoints.begin() + old_index);
+        checkpoints.insert(checkpoints.begin() + restart, fresh_checkpoints.begin(), fresh_checkpoints.end());
+    }
+    
+    // Leave the lexer exhausted, like after a full tokenize()
+    position = static_cast<int>(source.length());
+    current_char = '\0';
+    at_line_start = false;
+    while (indent_stack.size() > 1) {
+        indent_stack.pop();
+    }
     
     return tokens;
 }
 
+void Lexer::reset() {
+    position = 0;
+    line = 1;
+    column = 1;
+    current_indent = 0;
+    at_line_start = true;
+    current_char = source.empty() ? '\0' : source[0];
+    indent_stack = std::stack<int>();
+    indent_stack.push(0);
+    token_queue = std::queue<Token>();
+}
+
+void Lexer::restore(const LexerCheckpoint& checkpoint) {
+    position = checkpoint.position;
+    line = checkpoint.line;
+    // A line start is column 1, except at the end of the buffer where
+    // advance() stops counting; the buffer may have ended elsewhere when
+    // the checkpoint was taken
+    column = position < static_cast<int>(source.length()) || position == 0 ? 1 : 0;
+    indent_stack = checkpoint.indent_stack;
+    current_indent = indent_stack.top();
+    at_line_start = true;
+    current_char = position < static_cast<int>(source.length()) ? source[position] : '\0';
+    token_queue = std::queue<Token>();
+}
+
+bool Lexer::at_checkpoint(const std::vector<LexerCheckpoint>& recorded) const {
+    // Only line starts with no pending INDENT/DEDENT tokens are resumable
+    if (!at_line_start || !token_queue.empty()) {
+        return false;
+    }
+    return recorded.empty() || recorded.back().position != position;
+}
+
 void Lexer::advance() {
     if (position < source.length()) {
         if (current_char == '\n') {
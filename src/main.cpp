@@ -4,6 +4,10 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib> // Include for system()
 
 using namespace vypr;
@@ -14,11 +18,20 @@ void printUsage() {
     std::cout << "Options:\n";
     std::cout << "  -v, --verbose   Show compilation progress and debugging information\n";
     std::cout << "  -o <filename>  Specify output executable name (without extension)\n";
+    std::cout << "  --target=<t>   Output target: python (default) or pyext (CPython extension module)\n";
+    std::cout << "  --instrument=latency  Write per-function call counts and latency percentiles to <output>.latency.json\n";
+    std::cout << "  --instrument=types    Write the operand types seen at every operation and call to <output>.typeprof\n";
+    std::cout << "  --profile=<file>  Specialize the pyext target for the types recorded in a .typeprof file\n";
+    std::cout << "  -O0, -O1       Skip the IR optimizer, or run it (default)\n";
+    std::cout << "  --budget=<limit>=<n>  Limit the optimizer's effort; functions over budget are compiled at -O0.\n";
+    std::cout << "                 Limits: pass-ms, function-ms, total-ms (milliseconds), pass-work, function-work,\n";
+    std::cout << "                 total-work (whole number of instructions scanned); 0 removes a limit\n";
     std::cout << "  -h, --help     Show this help message\n";
 }
 
 int main(int argc, char* argv[]) {
     bool verbose = false;
+    CompilerOptions options;
     std::string output_file;
     std::string source_file;
     
@@ -35,6 +48,76 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             output_file = argv[++i];
+        } else if (arg.rfind("--target=", 0) == 0) {
+            std::string target = arg.substr(9);
+            if (target == "python") {
+                options.target = Target::PYTHON;
+            } else if (target == "pyext") {
+                options.target = Target::PYEXT;
+            } else {
+                std::cerr << "Error: Unknown target '" << target << "'\n";
+                printUsage();
+                return 1;
+            }
+        } else if (arg.rfind("--instrument=", 0) == 0) {
+            std::string kind = arg.substr(13);
+            if (kind == "latency") {
+                options.instrument_latency = true;
+            } else if (kind == "types") {
+                options.instrument_types = true;
+            } else {
+                std::cerr << "Error: Unknown instrumentation '" << kind << "'\n";
+                printUsage();
+                return 1;
+            }
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            options.profile_file = arg.substr(10);
+        } else if (arg == "-O0" || arg == "-O1") {
+            options.optimize = arg == "-O1";
+        } else if (arg.rfind("--budget=", 0) == 0) {
+            std::string setting = arg.substr(9);
+            size_t equals = setting.find('=');
+            std::string limit = setting.substr(0, equals);
+            std::string value = equals == std::string::npos ? "" : setting.substr(equals + 1);
+            // Time limits are any finite number of milliseconds, work limits a
+            // whole number of instructions
+            bool work = limit.size() > 5 && limit.compare(limit.size() - 5, 5, "-work") == 0;
+            char* end = nullptr;
+            errno = 0;
+            double amount = 0;
+            unsigned long long instructions = 0;
+            bool valid = !value.empty();
+            if (valid && work) {
+                instructions = std::strtoull(value.c_str(), &end, 10);
+                valid = std::isdigit(static_cast<unsigned char>(value[0])) && *end == '\0' && errno != ERANGE &&
+                        instructions <= SIZE_MAX;
+            } else if (valid) {
+                amount = std::strtod(value.c_str(), &end);
+                valid = *end == '\0' && std::isfinite(amount) && amount >= 0;
+            }
+            if (!valid) {
+                std::cerr << "Error: --budget needs <limit>=<non-negative number>, got '" << setting << "'\n";
+                printUsage();
+                return 1;
+            }
+            OptimizationBudget& budget = options.budget;
+            if (limit == "pass-ms") {
+                budget.passMilliseconds = amount;
+            } else if (limit == "function-ms") {
+                budget.functionMilliseconds = amount;
+            } else if (limit == "total-ms") {
+                budget.totalMilliseconds = amount;
+            } else if (limit == "pass-work") {
+                budget.passWork = static_cast<size_t>(instructions);
+            } else if (limit == "function-work") {
+                budget.functionWork = static_cast<size_t>(instructions);
+            } else if (limit == "total-work") {
+                budget.totalWork = static_cast<size_t>(instructions);
+            } else {
+                std::cerr << "Error: Unknown budget '" << limit << "'\n";
+                printUsage();
+                return 1;
+            }
         } else if (arg == "-h" || arg == "--help") {
             printUsage();
             return 0;
@@ -73,9 +156,17 @@ int main(int argc, char* argv[]) {
         file.close();
         
         // Compile
-        Compiler compiler;
+        Compiler compiler(false, options);
         std::string py_file = output_file + ".py"; // Keep track of the .py filename
         compiler.compile(source, output_file, verbose); // Pass base output name
+        
+        if (options.target == Target::PYEXT) {
+            std::cout << "Compilation successful!\n";
+            std::cout << "Output files:\n";
+            std::cout << "  - " << output_file << ".c\n";
+            std::cout << "  - " << compiler.getExtensionFile() << "\n";
+            return 0;
+        }
 
         std::cout << "Compilation successful!\n";
         std::cout << "Output files:\n";
@@ -135,6 +135,24 @@ StatementPtr Parser::var_declaration() {
         throw error(peek(), "Expected variable name.");
     }
     
+    // Destructuring declaration: var a, b = expr
+    if (check(TokenType::COMMA)) {
+        std::vector<std::string> names = {name};
+        while (match(TokenType::COMMA)) {
+            if (match(TokenType::IDENTIFIER)) {
+                names.push_back(std::get<std::string>(previous().value));
+            } else {
+                throw error(peek(), "Expected variable name after ','.");
+            }
+        }
+        
+        consume(TokenType::ASSIGN, "Expected '=' after destructuring variable names.");
+        ExpressionPtr initializer = expression();
+        
+        match(TokenType::NEWLINE);  // Consume the newline
+        return std::make_shared<DestructuringDeclaration>(names, initializer);
+    }
+    
     ExpressionPtr initializer = nullptr;
     if (match(TokenType::ASSIGN)) {
         initializer = expression();
@@ -299,14 +317,16 @@ StatementPtr Parser::loop_statement() {
 }
 
 StatementPtr Parser::return_statement() {
-    ExpressionPtr value = nullptr;
+    std::vector<ExpressionPtr> values;
     
     if (!check(TokenType::NEWLINE)) {
-        value = expression();
+        do {
+            values.push_back(expression());
+        } while (match(TokenType::COMMA));
     }
     
     match(TokenType::NEWLINE);  // Consume the newline
-    return std::make_shared<ReturnStatement>(value);
+    return std::make_shared<ReturnStatement>(values);
 }
 
 StatementPtr Parser::print_statement() {
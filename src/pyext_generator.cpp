@@ -0,0 +1,1197 @@
+#include "pyext_generator.h"
+#include "dataflow.h"
+#include "value_range.h"
+#include "exceptions.h"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <set>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace vypr {
+
+// Share of a site's executions one type signature needs to be speculated on
+static const double kSpeculationShare = 0.9;
+
+// Specialized copies per function, bounds the code growth
+static const size_t kMaxVariants = 4;
+
+// Python type of a literal, following how the constant pool builds it
+static std::string constantType(const std::string& text) {
+    if (text.size() >= 2 && (text.front() == '"' || text.front() == '\'') && text.back() == text.front()) {
+        return "str";
+    }
+    if (text == "true" || text == "false") {
+        return "bool";
+    }
+    bool numeric = !text.empty();
+    bool hasDot = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (i == 0 && text[i] == '-') continue;
+        if (text[i] == '.' && !hasDot) { hasDot = true; continue; }
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            numeric = false;
+            break;
+        }
+    }
+    if (numeric) {
+        return hasDot ? "float" : "int";
+    }
+    return "str";
+}
+
+// C test that `value` has exactly the speculated type, empty when the type
+// is not speculated on
+static std::string typeCheck(const std::string& type, const std::string& value) {
+    if (type == "int") return "PyLong_CheckExact(" + value + ")";
+    if (type == "float") return "PyFloat_CheckExact(" + value + ")";
+    if (type == "str") return "PyUnicode_CheckExact(" + value + ")";
+    return "";
+}
+
+static bool isNumberType(const std::string& type) {
+    return type == "int" || type == "float";
+}
+
+static const std::map<std::string, std::string>& comparisonOps() {
+    static const std::map<std::string, std::string> ops = {
+        {"==", "Py_EQ"}, {"!=", "Py_NE"}, {"<", "Py_LT"}, {"<=", "Py_LE"}, {">", "Py_GT"}, {">=", "Py_GE"}
+    };
+    return ops;
+}
+
+// Fast path of a binary operator on operands of the given types, empty when
+// there is none
+static std::string fastBinaryOp(const std::string& op, const std::string& leftType, const std::string& rightType,
+                                const std::string& left, const std::string& right) {
+    static const std::map<std::string, std::string> names = {
+        {"+", "add"}, {"-", "sub"}, {"*", "mul"}, {"/", "div"}, {"%", "mod"}
+    };
+    std::string args = "(" + left + ", " + right + ")";
+
+    if (op == "^" && leftType == "str" && rightType == "str") {
+        return "PyUnicode_Concat" + args;
+    }
+    if (leftType == "int" && rightType == "int") {
+        if (names.count(op)) {
+            return "_vypr_int_" + names.at(op) + args;
+        }
+        if (comparisonOps().count(op)) {
+            return "_vypr_int_compare(" + left + ", " + right + ", " + comparisonOps().at(op) + ")";
+        }
+    }
+    if (isNumberType(leftType) && isNumberType(rightType)) {
+        // Mixed comparisons are exact in Python, so only float pairs compare as doubles
+        if (names.count(op) && op != "%") {
+            return "_vypr_float_" + names.at(op) + args;
+        }
+        if (comparisonOps().count(op) && leftType == "float" && rightType == "float") {
+            return "_vypr_float_compare(" + left + ", " + right + ", " + comparisonOps().at(op) + ")";
+        }
+    }
+    return "";
+}
+
+// Type of a binary operation's result when the operand types are certain
+static std::string resultType(const std::string& op, const std::string& left, const std::string& right) {
+    if (op == "^") {
+        return "str";
+    }
+    if (left.empty() || right.empty()) {
+        return "";
+    }
+    if (comparisonOps().count(op)) {
+        return "bool";
+    }
+    if ((op == "&&" || op == "||") && left == right) {
+        return left;
+    }
+    if (left == "int" && right == "int" && op != "/") {
+        return op == "+" || op == "-" || op == "*" || op == "%" ? "int" : "";
+    }
+    if (isNumberType(left) && isNumberType(right) && (op == "+" || op == "-" || op == "*" || op == "/" || op == "%")) {
+        return "float";
+    }
+    return "";
+}
+
+PyExtGenerator::PyExtGenerator(bool verbose) : verbose(verbose) {}
+
+void PyExtGenerator::useTypeProfile(const TypeProfile& profile, const std::string& reportFile) {
+    this->profile = &profile;
+    guardReportFile = reportFile;
+}
+
+void PyExtGenerator::generate(const std::vector<IRFunction>& functions, const std::string& moduleName, const std::string& outputFile) {
+    // Open output file
+    outFile.open(outputFile);
+    if (!outFile.is_open()) {
+        throw CodeGenError("Could not open output file: " + outputFile);
+    }
+
+    if (verbose) {
+        std::cout << "Generating CPython extension source to " << outputFile << std::endl;
+    }
+
+    constants.clear();
+    functionNames.clear();
+    aliases.clear();
+    for (const auto& function : functions) {
+        functionNames.insert(function.name);
+        if (!function.aliasOf.empty()) {
+            aliases[function.name] = function.aliasOf;
+        }
+        collectConstants(function);
+    }
+
+    // Merged functions have no code of their own
+    variants.clear();
+    variantOrder.clear();
+    for (const auto& function : functions) {
+        if (function.aliasOf.empty()) {
+            addVariant(function, {});
+        }
+    }
+    if (profile) {
+        planSpeculation(functions);
+    }
+
+    writeHeader();
+    writeConstants();
+    if (profile) {
+        writeSpeculationRuntime();
+    }
+
+    // Forward declarations so functions can call each other in any order
+    for (const auto& cName : variantOrder) {
+        const IRFunction& function = *variants.at(cName).function;
+        outFile << "static PyObject* " << cName << "(";
+        for (size_t i = 0; i < function.parameters.size(); ++i) {
+            outFile << (i > 0 ? ", " : "") << "PyObject*";
+        }
+        outFile << (function.parameters.empty() ? "void" : "") << ");\n";
+    }
+    outFile << "\n";
+
+    for (const auto& cName : variantOrder) {
+        writeFunction(*variants.at(cName).function, cName);
+    }
+
+    writeModule(functions, moduleName);
+
+    outFile.close();
+
+    if (verbose) {
+        std::cout << "Code generation complete." << std::endl;
+    }
+}
+
+std::string PyExtGenerator::build(const std::string& sourceFile, const std::string& outputBase) {
+    const char* pythonEnv = std::getenv("PYTHON");
+    const char* ccEnv = std::getenv("CC");
+    std::string python = pythonEnv ? pythonEnv : "python";
+    std::string cc = ccEnv ? ccEnv : "cc";
+
+    // Ask the target interpreter where its headers live and how extensions are named
+    std::string query = python + " -c \"import sysconfig; "
+                        "print(sysconfig.get_paths()['include']); "
+                        "print(sysconfig.get_config_var('EXT_SUFFIX'))\"";
+    std::stringstream info(runCommand(query));
+    std::string includeDir;
+    std::string suffix;
+    std::getline(info, includeDir);
+    std::getline(info, suffix);
+    if (includeDir.empty() || suffix.empty()) {
+        throw CodeGenError("Could not query Python build configuration using '" + python + "'");
+    }
+
+    std::string library = outputBase + suffix;
+    std::string command = cc + " -O2 -shared -fPIC -I\"" + includeDir + "\" \"" + sourceFile + "\" -o \"" + library + "\"";
+    if (verbose) {
+        std::cout << "Building extension: " << command << std::endl;
+    }
+    if (std::system(command.c_str()) != 0) {
+        throw CodeGenError("Building the extension module failed: " + command);
+    }
+
+    return library;
+}
+
+void PyExtGenerator::writeHeader() {
+    outFile << "/* Generated by Vypr Compiler */\n";
+    outFile << "#define PY_SSIZE_T_CLEAN\n";
+    outFile << "#include <Python.h>\n\n";
+
+    outFile << "/* Replace an owned reference */\n";
+    outFile << "#define VYPR_SET(dst, val) do { PyObject* _old = (dst); (dst) = (val); Py_XDECREF(_old); } while (0)\n\n";
+
+    // Runtime helpers mirror the ones of the Python backend
+    outFile << "static PyObject* _vypr_print_fn;\n";
+    outFile << "static PyObject* _vypr_input_fn;\n\n";
+
+    outFile << "static PyObject* _vypr_concat(PyObject* a, PyObject* b) {\n";
+    outFile << "    PyObject* sa = PyObject_Str(a);\n";
+    outFile << "    if (!sa) return NULL;\n";
+    outFile << "    PyObject* sb = PyObject_Str(b);\n";
+    outFile << "    if (!sb) { Py_DECREF(sa); return NULL; }\n";
+    outFile << "    PyObject* r = PyUnicode_Concat(sa, sb);\n";
+    outFile << "    Py_DECREF(sa);\n";
+    outFile << "    Py_DECREF(sb);\n";
+    outFile << "    return r;\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyObject* _vypr_and(PyObject* a, PyObject* b) {\n";
+    outFile << "    int t = PyObject_IsTrue(a);\n";
+    outFile << "    if (t < 0) return NULL;\n";
+    outFile << "    PyObject* r = t ? b : a;\n";
+    outFile << "    Py_INCREF(r);\n";
+    outFile << "    return r;\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyObject* _vypr_or(PyObject* a, PyObject* b) {\n";
+    outFile << "    int t = PyObject_IsTrue(a);\n";
+    outFile << "    if (t < 0) return NULL;\n";
+    outFile << "    PyObject* r = t ? a : b;\n";
+    outFile << "    Py_INCREF(r);\n";
+    outFile << "    return r;\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyObject* _vypr_not(PyObject* a) {\n";
+    outFile << "    int t = PyObject_Not(a);\n";
+    outFile << "    if (t < 0) return NULL;\n";
+    outFile << "    return PyBool_FromLong(t);\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyObject* _vypr_bool(PyObject* a) {\n";
+    outFile << "    int t = PyObject_IsTrue(a);\n";
+    outFile << "    if (t < 0) return NULL;\n";
+    outFile << "    return PyBool_FromLong(t);\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyObject* _vypr_length(PyObject* a) {\n";
+    outFile << "    Py_ssize_t n = PyObject_Length(a);\n";
+    outFile << "    if (n < 0) return NULL;\n";
+    outFile << "    return PyLong_FromSsize_t(n);\n";
+    outFile << "}\n\n";
+
+    // Indexing at positions the value-range analysis proved to be in [0,
+    // length): no index conversion, negative wrap-around or IndexError path.
+    // Vypr lists never shrink, the size compare only keeps native callers
+    // that pass in lists they mutate from callbacks memory safe.
+    outFile << "static PyObject* _vypr_item(PyObject* a, PyObject* i) {\n";
+    outFile << "    Py_ssize_t k = PyLong_AsSsize_t(i);\n";
+    outFile << "    if (PyList_CheckExact(a) && (size_t)k < (size_t)PyList_GET_SIZE(a)) {\n";
+    outFile << "        PyObject* r = PyList_GET_ITEM(a, k);\n";
+    outFile << "        Py_INCREF(r);\n";
+    outFile << "        return r;\n";
+    outFile << "    }\n";
+    outFile << "    return PyObject_GetItem(a, i);\n";
+    outFile << "}\n\n";
+
+    outFile << "static int _vypr_set_item(PyObject* a, PyObject* i, PyObject* v) {\n";
+    outFile << "    Py_ssize_t k = PyLong_AsSsize_t(i);\n";
+    outFile << "    if (PyList_CheckExact(a) && (size_t)k < (size_t)PyList_GET_SIZE(a)) {\n";
+    outFile << "        PyObject* old = PyList_GET_ITEM(a, k);\n";
+    outFile << "        Py_INCREF(v);\n";
+    outFile << "        PyList_SET_ITEM(a, k, v);\n";
+    outFile << "        Py_DECREF(old);\n";
+    outFile << "        return 0;\n";
+    outFile << "    }\n";
+    outFile << "    return PyObject_SetItem(a, i, v);\n";
+    outFile << "}\n\n";
+
+    outFile << "static int _vypr_print(PyObject* a) {\n";
+    outFile << "    PyObject* r = PyObject_CallFunctionObjArgs(_vypr_print_fn, a, NULL);\n";
+    outFile << "    if (!r) return -1;\n";
+    outFile << "    Py_DECREF(r);\n";
+    outFile << "    return 0;\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyObject* _vypr_input(void) {\n";
+    outFile << "    return PyObject_CallObject(_vypr_input_fn, NULL);\n";
+    outFile << "}\n\n";
+
+    outFile << "static int _vypr_unbound(const char* name) {\n";
+    outFile << "    PyErr_Format(PyExc_NameError, \"name '%s' is not defined\", name);\n";
+    outFile << "    return -1;\n";
+    outFile << "}\n\n";
+}
+
+void PyExtGenerator::writeSpeculationRuntime() {
+    // Fast paths run on operands that passed their type guards. Ints of a
+    // single digit are unboxed; their sums and products fit a long long.
+    outFile << "#if PY_VERSION_HEX < 0x030B0000\n";
+    outFile << "#include <longintrepr.h>\n";
+    outFile << "#endif\n";
+    outFile << "#if PY_VERSION_HEX >= 0x030C0000\n";
+    outFile << "#define VYPR_SMALL(o) PyUnstable_Long_IsCompact((PyLongObject*)(o))\n";
+    outFile << "#define VYPR_SMALL_VALUE(o) ((long long)PyUnstable_Long_CompactValue((PyLongObject*)(o)))\n";
+    outFile << "#else\n";
+    outFile << "#define VYPR_SMALL(o) (Py_SIZE(o) >= -1 && Py_SIZE(o) <= 1)\n";
+    outFile << "#define VYPR_SMALL_VALUE(o) ((long long)Py_SIZE(o) * (long long)((PyLongObject*)(o))->ob_digit[0])\n";
+    outFile << "#endif\n\n";
+
+    static const std::vector<std::vector<std::string>> intOps = {
+        {"add", "+", "PyNumber_Add"}, {"sub", "-", "PyNumber_Subtract"}, {"mul", "*", "PyNumber_Multiply"}
+    };
+    for (const auto& op : intOps) {
+        outFile << "static PyObject* _vypr_int_" << op[0] << "(PyObject* a, PyObject* b) {\n";
+        outFile << "    if (VYPR_SMALL(a) && VYPR_SMALL(b)) return PyLong_FromLongLong(VYPR_SMALL_VALUE(a) " << op[1]
+                << " VYPR_SMALL_VALUE(b));\n";
+        outFile << "    return " << op[2] << "(a, b);\n";
+        outFile << "}\n\n";
+    }
+
+    // Single digits are exact doubles, so their quotient rounds like Python's
+    outFile << "static PyObject* _vypr_int_div(PyObject* a, PyObject* b) {\n";
+    outFile << "    if (VYPR_SMALL(a) && VYPR_SMALL(b) && VYPR_SMALL_VALUE(b) != 0)\n";
+    outFile << "        return PyFloat_FromDouble((double)VYPR_SMALL_VALUE(a) / (double)VYPR_SMALL_VALUE(b));\n";
+    outFile << "    return PyNumber_TrueDivide(a, b);\n";
+    outFile << "}\n\n";
+
+    // Python's remainder takes the sign of the divisor
+    outFile << "static PyObject* _vypr_int_mod(PyObject* a, PyObject* b) {\n";
+    outFile << "    if (VYPR_SMALL(a) && VYPR_SMALL(b) && VYPR_SMALL_VALUE(b) != 0) {\n";
+    outFile << "        long long y = VYPR_SMALL_VALUE(b);\n";
+    outFile << "        long long r = VYPR_SMALL_VALUE(a) % y;\n";
+    outFile << "        if (r != 0 && ((r < 0) != (y < 0))) r += y;\n";
+    outFile << "        return PyLong_FromLongLong(r);\n";
+    outFile << "    }\n";
+    outFile << "    return PyNumber_Remainder(a, b);\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyObject* _vypr_int_compare(PyObject* a, PyObject* b, int op) {\n";
+    outFile << "    if (VYPR_SMALL(a) && VYPR_SMALL(b)) Py_RETURN_RICHCOMPARE(VYPR_SMALL_VALUE(a), VYPR_SMALL_VALUE(b), op);\n";
+    outFile << "    return PyObject_RichCompare(a, b, op);\n";
+    outFile << "}\n\n";
+
+    // Mixed int and float operands convert the int like Python does
+    outFile << "static int _vypr_doubles(PyObject* a, PyObject* b, double* x, double* y) {\n";
+    outFile << "    *x = PyFloat_CheckExact(a) ? PyFloat_AS_DOUBLE(a) : PyLong_AsDouble(a);\n";
+    outFile << "    if (*x == -1.0 && PyErr_Occurred()) return -1;\n";
+    outFile << "    *y = PyFloat_CheckExact(b) ? PyFloat_AS_DOUBLE(b) : PyLong_AsDouble(b);\n";
+    outFile << "    if (*y == -1.0 && PyErr_Occurred()) return -1;\n";
+    outFile << "    return 0;\n";
+    outFile << "}\n\n";
+
+    static const std::vector<std::pair<std::string, std::string>> floatOps = {
+        {"add", "+"}, {"sub", "-"}, {"mul", "*"}, {"div", "/"}
+    };
+    for (const auto& [name, op] : floatOps) {
+        outFile << "static PyObject* _vypr_float_" << name << "(PyObject* a, PyObject* b) {\n";
+        outFile << "    double x, y;\n";
+        outFile << "    if (_vypr_doubles(a, b, &x, &y) < 0) return NULL;\n";
+        if (op == "/") {
+            outFile << "    if (y == 0.0) return PyNumber_TrueDivide(a, b);\n";
+        }
+        outFile << "    return PyFloat_FromDouble(x " << op << " y);\n";
+        outFile << "}\n\n";
+    }
+
+    outFile << "static PyObject* _vypr_float_compare(PyObject* a, PyObject* b, int op) {\n";
+    outFile << "    Py_RETURN_RICHCOMPARE(PyFloat_AS_DOUBLE(a), PyFloat_AS_DOUBLE(b), op);\n";
+    outFile << "}\n\n";
+
+    // Guard counters per speculated site, reported at exit
+    size_t slots = guardSites.size();
+    std::string size = std::to_string(slots == 0 ? 1 : slots);
+    outFile << "static unsigned long long _vypr_guard_hits[" << size << "];\n";
+    outFile << "static unsigned long long _vypr_guard_misses[" << size << "];\n";
+    std::vector<std::pair<std::string, const std::vector<std::string>*>> tables = {
+        {"_vypr_guard_sites", &guardSites}, {"_vypr_guard_what", &guardWhat}, {"_vypr_guard_types", &guardTypes}
+    };
+    for (const auto& [table, entries] : tables) {
+        outFile << "static const char* const " << table << "[" << size << "] = {";
+        for (size_t i = 0; i < entries->size(); ++i) {
+            outFile << (i > 0 ? ", " : "") << cStringLiteral((*entries)[i]);
+        }
+        outFile << (entries->empty() ? "NULL" : "") << "};\n";
+    }
+    outFile << "\n";
+
+    outFile << "static PyObject* _vypr_write_guards(PyObject* self, PyObject* unused) {\n";
+    outFile << "    const char* separator = \"\";\n";
+    outFile << "    FILE* f = fopen(" << cStringLiteral(guardReportFile) << ", \"w\");\n";
+    outFile << "    (void)self;\n";
+    outFile << "    (void)unused;\n";
+    outFile << "    if (!f) Py_RETURN_NONE;\n";
+    outFile << "    fprintf(f, \"{\");\n";
+    outFile << "    for (int i = 0; i < " << slots << "; ++i) {\n";
+    outFile << "        unsigned long long total = _vypr_guard_hits[i] + _vypr_guard_misses[i];\n";
+    outFile << "        if (!total) continue;\n";
+    outFile << "        fprintf(f, \"%s\\n  \\\"%s\\\": {\\\"what\\\": \\\"%s\\\", \\\"speculated\\\": \\\"%s\\\", "
+               "\\\"hits\\\": %llu, \\\"misses\\\": %llu, \\\"failure_rate\\\": %.6f}\",\n";
+    outFile << "                separator, _vypr_guard_sites[i], _vypr_guard_what[i], _vypr_guard_types[i],\n";
+    outFile << "                _vypr_guard_hits[i], _vypr_guard_misses[i], (double)_vypr_guard_misses[i] / (double)total);\n";
+    outFile << "        separator = \",\";\n";
+    outFile << "    }\n";
+    outFile << "    fprintf(f, \"\\n}\\n\");\n";
+    outFile << "    fclose(f);\n";
+    outFile << "    Py_RETURN_NONE;\n";
+    outFile << "}\n\n";
+
+    outFile << "static PyMethodDef _vypr_write_guards_def = {\"_vypr_write_guards\", _vypr_write_guards, METH_NOARGS, NULL};\n\n";
+}
+
+void PyExtGenerator::writeConstants() {
+    outFile << "static PyObject* _vypr_const[" << (constants.empty() ? 1 : constants.size()) << "];\n\n";
+
+    outFile << "static int _vypr_init_constants(void) {\n";
+    for (const auto& [text, index] : constants) {
+        std::string slot = "_vypr_const[" + std::to_string(index) + "]";
+        std::string type = constantType(text);
+        bool quoted = text.size() >= 2 && (text.front() == '"' || text.front() == '\'') && text.back() == text.front();
+
+        if (quoted) {
+            outFile << "    " << slot << " = PyUnicode_FromString(" << cStringLiteral(text.substr(1, text.size() - 2)) << ");\n";
+        } else if (type == "bool") {
+            outFile << "    " << slot << " = " << (text == "true" ? "Py_True" : "Py_False") << ";\n";
+            outFile << "    Py_INCREF(" << slot << ");\n";
+        } else if (type == "float") {
+            outFile << "    " << slot << " = PyFloat_FromDouble(" << text << ");\n";
+        } else if (type == "int") {
+            outFile << "    " << slot << " = PyLong_FromString(\"" << text << "\", NULL, 10);\n";
+        } else {
+            // Bare text is treated as a string, like the Python backend does
+            outFile << "    " << slot << " = PyUnicode_FromString(" << cStringLiteral(text) << ");\n";
+        }
+        outFile << "    if (!" << slot << ") return -1;\n";
+    }
+    outFile << "    return 0;\n";
+    outFile << "}\n\n";
+}
+
+void PyExtGenerator::collectConstants(const IRFunction& function) {
+    auto add = [this](const std::string& text, bool literal = false) {
+        if ((literal || !isIRName(text)) && !constants.count(text)) {
+            int index = static_cast<int>(constants.size());
+            constants[text] = index;
+        }
+    };
+
+    for (const auto& instr : function.instructions) {
+        switch (instr.opcode) {
+            case IROpCode::LOAD_CONST:
+                add(instr.operands[1], true);
+                break;
+            case IROpCode::BINARY_OP:
+                add(instr.operands[1]);
+                add(instr.operands[3]);
+                break;
+            case IROpCode::UNARY_OP:
+                add(instr.operands[2]);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void PyExtGenerator::planSpeculation(const std::vector<IRFunction>& functions) {
+    guardSlots.clear();
+    guardSites.clear();
+    guardWhat.clear();
+    guardTypes.clear();
+
+    std::map<std::string, const IRFunction*> bodies;
+    for (const auto& function : functions) {
+        if (function.aliasOf.empty()) {
+            bodies[function.name] = &function;
+        }
+    }
+
+    // Planning a variant may ask for specialized variants of its callees
+    for (size_t i = 0; i < variantOrder.size(); ++i) {
+        planVariant(variantOrder[i], bodies);
+    }
+
+    if (verbose) {
+        for (size_t i = 0; i < guardSites.size(); ++i) {
+            std::cout << "  speculating " << guardTypes[i] << " for '" << guardWhat[i] << "' at " << guardSites[i] << "\n";
+        }
+        for (const auto& cName : variantOrder) {
+            const VariantPlan& plan = variants.at(cName);
+            if (!plan.parameterTypes.empty()) {
+                std::cout << "  specialized '" << plan.function->name << "' as " << cName << "\n";
+            }
+        }
+    }
+}
+
+std::string PyExtGenerator::addVariant(const IRFunction& function, const std::vector<std::string>& parameterTypes) {
+    std::string cName = (parameterTypes.empty() ? "vypr_fn_" : "vypr_sp_") + function.name;
+    if (!parameterTypes.empty()) {
+        cName += "_";
+        for (const auto& type : parameterTypes) {
+            cName += "_" + (type.empty() ? std::string("any") : type);
+        }
+    }
+    if (variants.count(cName)) {
+        return cName;
+    }
+
+    if (!parameterTypes.empty()) {
+        size_t copies = 0;
+        for (const auto& [name, plan] : variants) {
+            copies += plan.function == &function && !plan.parameterTypes.empty();
+        }
+        if (copies >= kMaxVariants) {
+            return "";
+        }
+    }
+
+    VariantPlan& plan = variants[cName];
+    plan.function = &function;
+    plan.parameterTypes = parameterTypes;
+    variantOrder.push_back(cName);
+    return cName;
+}
+
+void PyExtGenerator::planVariant(const std::string& cName, const std::map<std::string, const IRFunction*>& bodies) {
+    VariantPlan& plan = variants.at(cName);
+    const IRFunction& function = *plan.function;
+
+    std::map<std::string, int> definitions;
+    for (const auto& instr : function.instructions) {
+        for (const auto& name : irDefinedNames(instr)) {
+            ++definitions[name];
+        }
+    }
+
+    // Specialized parameters are certain as long as the body never assigns them
+    std::set<std::string> parameters(function.parameters.begin(), function.parameters.end());
+    for (size_t i = 0; i < plan.parameterTypes.size(); ++i) {
+        if (!plan.parameterTypes[i].empty() && !definitions.count(function.parameters[i])) {
+            plan.known[function.parameters[i]] = plan.parameterTypes[i];
+        }
+    }
+
+    // Names with a single definition take the type that definition produces
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& instr : function.instructions) {
+            std::vector<std::string> defined = irDefinedNames(instr);
+            if (defined.size() != 1 || definitions[defined[0]] != 1 || parameters.count(defined[0]) ||
+                plan.known.count(defined[0])) {
+                continue;
+            }
+
+            std::string type;
+            switch (instr.opcode) {
+                case IROpCode::LOAD_CONST: type = constantType(instr.operands[1]); break;
+                case IROpCode::LOAD_VAR:
+                case IROpCode::STORE_VAR:  type = staticType(instr.operands[1], plan); break;
+                case IROpCode::BINARY_OP:
+                    type = resultType(instr.operands[2], staticType(instr.operands[1], plan), staticType(instr.operands[3], plan));
+                    break;
+                case IROpCode::CONVERT:    type = instr.operands[1]; break;
+                case IROpCode::INPUT:      type = "str"; break;
+                case IROpCode::MEMBER_GET: type = instr.operands[2] == "length" ? "int" : ""; break;
+                default: break;
+            }
+            if (!type.empty()) {
+                plan.known[defined[0]] = type;
+                changed = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < function.instructions.size(); ++i) {
+        const auto& instr = function.instructions[i];
+        std::string site = TypeProfile::siteId(function.name, i);
+
+        if (instr.opcode == IROpCode::BINARY_OP) {
+            const std::string& op = instr.operands[2];
+            const SiteProfile* observed = profile->find(site, op);
+            std::vector<std::string> seen = observed ? observed->dominant(kSpeculationShare) : std::vector<std::string>();
+
+            // Certain types win over the profile; unknown operands need a guard
+            std::vector<std::string> types;
+            bool checked = false;
+            for (size_t k = 0; k < 2; ++k) {
+                std::string type = staticType(instr.operands[1 + 2 * k], plan);
+                if (type.empty() && seen.size() == 2 && !typeCheck(seen[k], "").empty()) {
+                    type = seen[k];
+                    checked = true;
+                }
+                types.push_back(type);
+            }
+            if (types[0].empty() || types[1].empty() || fastBinaryOp(op, types[0], types[1], "", "").empty()) {
+                continue;
+            }
+            plan.types[i] = types;
+            if (checked) {
+                addGuard(site, op, types);
+            }
+        } else if (instr.opcode == IROpCode::CALL && instr.operands.size() > 2) {
+            std::string callee = aliases.count(instr.operands[1]) ? aliases.at(instr.operands[1]) : instr.operands[1];
+            if (!bodies.count(callee)) {
+                continue;
+            }
+            std::vector<std::string> args = splitOperandList(instr.operands[2]);
+            const SiteProfile* observed = profile->find(site, instr.operands[1]);
+            std::vector<std::string> seen = observed ? observed->dominant(kSpeculationShare) : std::vector<std::string>();
+
+            // Only types the specialized body can use are worth a guard
+            std::vector<std::string> types;
+            bool checked = false;
+            bool useful = false;
+            for (size_t k = 0; k < args.size(); ++k) {
+                std::string type = staticType(args[k], plan);
+                if (type.empty() && seen.size() == args.size()) {
+                    type = seen[k];
+                    checked = checked || !typeCheck(type, "").empty();
+                }
+                if (typeCheck(type, "").empty()) {
+                    type.clear();
+                }
+                useful = useful || !type.empty();
+                types.push_back(type);
+            }
+            if (!useful || types.size() != bodies.at(callee)->parameters.size()) {
+                continue;
+            }
+            std::string target = addVariant(*bodies.at(callee), types);
+            if (target.empty()) {
+                continue;
+            }
+            plan.types[i] = types;
+            plan.targets[i] = target;
+            if (checked) {
+                addGuard(site, instr.operands[1], types);
+            }
+        }
+    }
+}
+
+std::string PyExtGenerator::staticType(const std::string& operand, const VariantPlan& plan) const {
+    if (!isIRName(operand)) {
+        return constantType(operand);
+    }
+    auto it = plan.known.find(operand);
+    return it == plan.known.end() ? "" : it->second;
+}
+
+void PyExtGenerator::addGuard(const std::string& site, const std::string& what, const std::vector<std::string>& types) {
+    if (guardSlots.count(site)) {
+        return;
+    }
+    std::string signature;
+    for (size_t i = 0; i < types.size(); ++i) {
+        signature += (i > 0 ? "," : "") + (types[i].empty() ? std::string("any") : types[i]);
+    }
+    guardSlots[site] = guardSites.size();
+    guardSites.push_back(site);
+    guardWhat.push_back(what);
+    guardTypes.push_back(signature);
+}
+
+void PyExtGenerator::writeFunction(const IRFunction& function, const std::string& cName) {
+    // Every parameter, variable and temp becomes an owned local reference
+    std::set<std::string> locals(function.parameters.begin(), function.parameters.end());
+    std::set<std::string> labels;
+    for (const auto& instr : function.instructions) {
+        for (const auto& name : irDefinedNames(instr)) {
+            locals.insert(name);
+        }
+        for (const auto& name : irUsedNames(instr)) {
+            locals.insert(name);
+        }
+        if (instr.opcode == IROpCode::LABEL) {
+            if (labels.count(instr.operands[0])) {
+                throw CodeGenError("Duplicate label found in IR function '" + function.name + "': " + instr.operands[0]);
+            }
+            labels.insert(instr.operands[0]);
+        }
+    }
+
+    // Labels must reference existing targets
+    for (const auto& instr : function.instructions) {
+        if (instr.opcode == IROpCode::JUMP && !labels.count(instr.operands[0])) {
+            throw CodeGenError("Undefined label referenced in JUMP: " + instr.operands[0]);
+        }
+        if ((instr.opcode == IROpCode::JUMP_IF_FALSE || instr.opcode == IROpCode::JUMP_IF_TRUE) &&
+            !labels.count(instr.operands[1])) {
+            throw CodeGenError("Undefined label referenced in " + irOpCodeToString(instr.opcode) + ": " + instr.operands[1]);
+        }
+    }
+
+    outFile << "static PyObject* " << cName << "(";
+    for (size_t i = 0; i < function.parameters.size(); ++i) {
+        outFile << (i > 0 ? ", " : "") << "PyObject* a" << i;
+    }
+    outFile << (function.parameters.empty() ? "void" : "") << ") {\n";
+
+    outFile << "    PyObject* _ret = NULL;\n";
+    outFile << "    PyObject* _tmp = NULL;\n";
+    for (const auto& name : locals) {
+        outFile << "    PyObject* " << local(name) << " = NULL;\n";
+    }
+    outFile << "    (void)_tmp;\n";
+    outFile << "    if (Py_EnterRecursiveCall(\" in Vypr function '" << function.name << "'\")) return NULL;\n";
+    for (size_t i = 0; i < function.parameters.size(); ++i) {
+        outFile << "    " << local(function.parameters[i]) << " = a" << i << ";\n";
+        outFile << "    Py_INCREF(a" << i << ");\n";
+    }
+
+    // Loads of variables assigned on every path need no unbound check
+    ControlFlowGraph cfg(function);
+    DataflowFacts initialized = computeDefiniteInitialization(cfg);
+    boundLoads.assign(function.instructions.size(), false);
+    for (size_t i = 0; i < function.instructions.size(); ++i) {
+        const auto& instr = function.instructions[i];
+        if (instr.opcode == IROpCode::LOAD_VAR) {
+            boundLoads[i] = isDefinitelyInitialized(cfg, initialized, i, instr.operands[1]);
+        }
+    }
+    ValueRangeAnalysis functionRanges(cfg);
+    ranges = &functionRanges;
+
+    currentPlan = profile ? &variants.at(cName) : nullptr;
+    for (size_t index = 0; index < function.instructions.size(); ++index) {
+        const auto& instr = function.instructions[index];
+        currentIndex = index;
+
+        outFile << "    /* " << instr.toString() << " */\n";
+        std::string code;
+        switch (instr.opcode) {
+            case IROpCode::LOAD_CONST:    code = handleLoadConst(instr); break;
+            case IROpCode::LOAD_VAR:      code = handleLoadVar(instr); break;
+            case IROpCode::STORE_VAR:     code = handleStoreVar(instr); break;
+            case IROpCode::BINARY_OP:     code = handleBinaryOp(instr); break;
+            case IROpCode::UNARY_OP:      code = handleUnaryOp(instr); break;
+            case IROpCode::JUMP:          code = handleJump(instr); break;
+            case IROpCode::JUMP_IF_FALSE:
+            case IROpCode::JUMP_IF_TRUE:  code = handleConditionalJump(instr); break;
+            case IROpCode::CALL:          code = handleCall(instr); break;
+            case IROpCode::RETURN:        code = handleReturn(instr); break;
+            case IROpCode::PRINT:         code = handlePrint(instr); break;
+            case IROpCode::INPUT:         code = handleInput(instr); break;
+            case IROpCode::ARRAY_NEW:     code = handleArrayNew(instr); break;
+            case IROpCode::ARRAY_GET:     code = handleArrayGet(instr); break;
+            case IROpCode::ARRAY_SET:     code = handleArraySet(instr); break;
+            case IROpCode::MEMBER_GET:    code = handleMemberGet(instr); break;
+            case IROpCode::CONVERT:       code = handleConvert(instr); break;
+            case IROpCode::UNPACK:        code = handleUnpack(instr); break;
+            case IROpCode::LABEL:         code = handleLabel(instr); break;
+            case IROpCode::NOP:           code = ";"; break;
+            default:
+                throw CodeGenError("Unsupported IR opcode encountered during C code generation: OpCode " + std::to_string(static_cast<int>(instr.opcode)));
+        }
+
+        // Labels stay in column 0, statements are indented
+        if (instr.opcode == IROpCode::LABEL) {
+            outFile << code << "\n";
+            continue;
+        }
+        std::stringstream lines(code);
+        std::string line;
+        while (std::getline(lines, line)) {
+            outFile << "    " << line << "\n";
+        }
+    }
+
+    // Falling off the end returns None
+    outFile << "    _ret = Py_None;\n";
+    outFile << "    Py_INCREF(_ret);\n";
+    outFile << "    goto done;\n";
+    outFile << "error:\n";
+    outFile << "    _ret = NULL;\n";
+    outFile << "done:\n";
+    for (const auto& name : locals) {
+        outFile << "    Py_XDECREF(" << local(name) << ");\n";
+    }
+    outFile << "    Py_LeaveRecursiveCall();\n";
+    outFile << "    return _ret;\n";
+    outFile << "}\n\n";
+    currentPlan = nullptr;
+    ranges = nullptr;
+
+    // Specialized variants are only reached through guarded calls
+    if (!variants.at(cName).parameterTypes.empty()) {
+        return;
+    }
+
+    // METH_FASTCALL wrapper exposed to Python
+    size_t arity = function.parameters.size();
+    outFile << "static PyObject* vypr_py_" << function.name << "(PyObject* self, PyObject* const* args, Py_ssize_t nargs) {\n";
+    outFile << "    (void)self;\n";
+    outFile << "    (void)args;\n";
+    outFile << "    if (nargs != " << arity << ") {\n";
+    outFile << "        PyErr_Format(PyExc_TypeError, \"" << function.name << "() takes " << arity
+            << " arguments (%zd given)\", nargs);\n";
+    outFile << "        return NULL;\n";
+    outFile << "    }\n";
+    outFile << "    return vypr_fn_" << function.name << "(";
+    for (size_t i = 0; i < arity; ++i) {
+        outFile << (i > 0 ? ", " : "") << "args[" << i << "]";
+    }
+    outFile << ");\n";
+    outFile << "}\n\n";
+}
+
+void PyExtGenerator::writeModule(const std::vector<IRFunction>& functions, const std::string& moduleName) {
+    outFile << "static PyMethodDef vypr_methods[] = {\n";
+    for (const auto& function : functions) {
+        const std::string& body = function.aliasOf.empty() ? function.name : function.aliasOf;
+        outFile << "    {\"" << function.name << "\", (PyCFunction)(void (*)(void))vypr_py_" << body
+                << ", METH_FASTCALL, NULL},\n";
+    }
+    outFile << "    {NULL, NULL, 0, NULL}\n";
+    outFile << "};\n\n";
+
+    outFile << "static struct PyModuleDef vypr_module = {\n";
+    outFile << "    PyModuleDef_HEAD_INIT, \"" << moduleName << "\", \"Generated by Vypr Compiler\", -1, vypr_methods,\n";
+    outFile << "    NULL, NULL, NULL, NULL\n";
+    outFile << "};\n\n";
+
+    outFile << "PyMODINIT_FUNC PyInit_" << moduleName << "(void) {\n";
+    outFile << "    PyObject* builtins = PyImport_ImportModule(\"builtins\");\n";
+    outFile << "    if (!builtins) return NULL;\n";
+    outFile << "    _vypr_print_fn = PyObject_GetAttrString(builtins, \"print\");\n";
+    outFile << "    _vypr_input_fn = PyObject_GetAttrString(builtins, \"input\");\n";
+    outFile << "    Py_DECREF(builtins);\n";
+    outFile << "    if (!_vypr_print_fn || !_vypr_input_fn) return NULL;\n";
+    outFile << "    if (_vypr_init_constants() < 0) return NULL;\n";
+    if (profile) {
+        outFile << "    {\n";
+        outFile << "        PyObject* atexit = PyImport_ImportModule(\"atexit\");\n";
+        outFile << "        PyObject* writer = atexit ? PyCFunction_New(&_vypr_write_guards_def, NULL) : NULL;\n";
+        outFile << "        PyObject* registered = writer ? PyObject_CallMethod(atexit, \"register\", \"O\", writer) : NULL;\n";
+        outFile << "        Py_XDECREF(registered);\n";
+        outFile << "        Py_XDECREF(writer);\n";
+        outFile << "        Py_XDECREF(atexit);\n";
+        outFile << "        if (!registered) return NULL;\n";
+        outFile << "    }\n";
+    }
+    outFile << "    return PyModule_Create(&vypr_module);\n";
+    outFile << "}\n";
+}
+
+std::string PyExtGenerator::handleLoadConst(const IRInstruction& instruction) {
+    std::string constant = "_vypr_const[" + std::to_string(constants.at(instruction.operands[1])) + "]";
+    return "Py_INCREF(" + constant + "); VYPR_SET(" + local(instruction.operands[0]) + ", " + constant + ");";
+}
+
+std::string PyExtGenerator::handleLoadVar(const IRInstruction& instruction) {
+    // Variables may be read before any assignment on some paths
+    std::string source = local(instruction.operands[1]);
+    if (boundLoads[currentIndex]) {
+        return "Py_INCREF(" + source + "); VYPR_SET(" + local(instruction.operands[0]) + ", " + source + ");";
+    }
+    return "if (!" + source + " && _vypr_unbound(\"" + instruction.operands[1] + "\") < 0) goto error;\nPy_INCREF(" +
+           source + "); VYPR_SET(" + local(instruction.operands[0]) + ", " + source + ");";
+}
+
+std::string PyExtGenerator::handleStoreVar(const IRInstruction& instruction) {
+    std::string source = value(instruction.operands[1]);
+    return "Py_INCREF(" + source + "); VYPR_SET(" + local(instruction.operands[0]) + ", " + source + ");";
+}
+
+std::string PyExtGenerator::handleBinaryOp(const IRInstruction& instruction) {
+    std::string unboxed = unboxedBinaryOp(instruction);
+    if (!unboxed.empty()) {
+        return assign(instruction.operands[0], unboxed);
+    }
+
+    std::string generic = binaryOpExpression(instruction);
+    if (!currentPlan || !currentPlan->types.count(currentIndex)) {
+        return assign(instruction.operands[0], generic);
+    }
+
+    const auto& types = currentPlan->types.at(currentIndex);
+    std::string fast = fastBinaryOp(instruction.operands[2], types[0], types[1], value(instruction.operands[1]),
+                                    value(instruction.operands[3]));
+    return guarded(instruction.operands[0], {instruction.operands[1], instruction.operands[3]}, types, fast, generic);
+}
+
+std::string PyExtGenerator::binaryOpExpression(const IRInstruction& instruction) const {
+    std::string left = value(instruction.operands[1]);
+    std::string op = instruction.operands[2];
+    std::string right = value(instruction.operands[3]);
+
+    static const std::map<std::string, std::string> numeric = {
+        {"+", "PyNumber_Add"}, {"-", "PyNumber_Subtract"}, {"*", "PyNumber_Multiply"},
+        {"/", "PyNumber_TrueDivide"}, {"%", "PyNumber_Remainder"},
+        {"^", "_vypr_concat"}, {"&&", "_vypr_and"}, {"||", "_vypr_or"}
+    };
+    if (numeric.count(op)) {
+        return numeric.at(op) + "(" + left + ", " + right + ")";
+    }
+    if (comparisonOps().count(op)) {
+        return "PyObject_RichCompare(" + left + ", " + right + ", " + comparisonOps().at(op) + ")";
+    }
+    throw CodeGenError("Unsupported binary operator in C code generation: " + op);
+}
+
+// Ints whose ranges fit 64 bits are computed and compared as long long;
+// the result range is finite, so the arithmetic cannot overflow
+std::string PyExtGenerator::unboxedBinaryOp(const IRInstruction& instruction) const {
+    IntRange left, right, result;
+    const std::string& op = instruction.operands[2];
+    if (!ranges->operandRange(currentIndex, instruction.operands[1], left) || !left.isFinite() ||
+        !ranges->operandRange(currentIndex, instruction.operands[3], right) || !right.isFinite()) {
+        return "";
+    }
+    std::string a = "PyLong_AsLongLong(" + value(instruction.operands[1]) + ")";
+    std::string b = "PyLong_AsLongLong(" + value(instruction.operands[3]) + ")";
+
+    static const std::set<std::string> arithmetic = {"+", "-", "*", "%"};
+    if (arithmetic.count(op) && ranges->resultRange(currentIndex, result) && result.isFinite()) {
+        // C's % truncates, which only agrees with Python's for non-negative operands
+        if (op == "%" && (left.lo < 0 || right.lo <= 0)) {
+            return "";
+        }
+        return "PyLong_FromLongLong(" + a + " " + op + " " + b + ")";
+    }
+    if (comparisonOps().count(op)) {
+        return "PyBool_FromLong(" + a + " " + op + " " + b + ")";
+    }
+    return "";
+}
+
+std::string PyExtGenerator::handleUnaryOp(const IRInstruction& instruction) {
+    std::string op = instruction.operands[1];
+    std::string operand = value(instruction.operands[2]);
+
+    if (op == "-") {
+        return assign(instruction.operands[0], "PyNumber_Negative(" + operand + ")");
+    }
+    if (op == "!") {
+        return assign(instruction.operands[0], "_vypr_not(" + operand + ")");
+    }
+    throw CodeGenError("Unsupported unary operator in C code generation: " + op);
+}
+
+std::string PyExtGenerator::handleJump(const IRInstruction& instruction) {
+    return "goto L_" + instruction.operands[0] + ";";
+}
+
+std::string PyExtGenerator::handleConditionalJump(const IRInstruction& instruction) {
+    std::string jumpWhen = instruction.opcode == IROpCode::JUMP_IF_FALSE ? "!_t" : "_t";
+    return "{ int _t = PyObject_IsTrue(" + value(instruction.operands[0]) + "); if (_t < 0) goto error;\nif (" +
+           jumpWhen + ") goto L_" + instruction.operands[1] + "; }";
+}
+
+std::string PyExtGenerator::handleCall(const IRInstruction& instruction) {
+    std::string function = instruction.operands[1];
+    if (!functionNames.count(function)) {
+        throw CodeGenError("Call to unknown function in C code generation: " + function);
+    }
+    if (aliases.count(function)) {
+        function = aliases.at(function);
+    }
+
+    std::vector<std::string> args;
+    if (instruction.operands.size() > 2) {
+        for (const auto& arg : splitOperandList(instruction.operands[2])) {
+            args.push_back(value(arg));
+        }
+    }
+
+    // Vypr functions call each other directly, without going through Python
+    std::string generic = "vypr_fn_" + function + "(" + joinOperandList(args) + ")";
+    if (!currentPlan || !currentPlan->targets.count(currentIndex)) {
+        return assign(instruction.operands[0], generic);
+    }
+    std::string fast = currentPlan->targets.at(currentIndex) + "(" + joinOperandList(args) + ")";
+    return guarded(instruction.operands[0], splitOperandList(instruction.operands[2]), currentPlan->types.at(currentIndex),
+                   fast, generic);
+}
+
+std::string PyExtGenerator::guarded(const std::string& target, const std::vector<std::string>& operands,
+                                    const std::vector<std::string>& types, const std::string& fast,
+                                    const std::string& generic) {
+    // Operands whose type is certain need no guard
+    std::string condition;
+    for (size_t i = 0; i < operands.size(); ++i) {
+        if (!types[i].empty() && staticType(operands[i], *currentPlan).empty()) {
+            condition += (condition.empty() ? "" : " && ") + typeCheck(types[i], value(operands[i]));
+        }
+    }
+    if (condition.empty()) {
+        return assign(target, fast);
+    }
+
+    std::string slot = std::to_string(guardSlots.at(TypeProfile::siteId(currentPlan->function->name, currentIndex)));
+    return "if (" + condition + ") {\n    _vypr_guard_hits[" + slot + "]++;\n    _tmp = " + fast +
+           ";\n} else {\n    _vypr_guard_misses[" + slot + "]++;\n    _tmp = " + generic +
+           ";\n}\nif (!_tmp) goto error;\nVYPR_SET(" + local(target) + ", _tmp);";
+}
+
+std::string PyExtGenerator::handleReturn(const IRInstruction& instruction) {
+    if (instruction.operands.empty()) {
+        return "_ret = Py_None; Py_INCREF(_ret); goto done;";
+    }
+    if (instruction.operands.size() == 1) {
+        std::string result = value(instruction.operands[0]);
+        return "_ret = " + result + "; Py_INCREF(_ret); goto done;";
+    }
+
+    // Multiple values are returned as a tuple
+    std::vector<std::string> values;
+    for (const auto& operand : instruction.operands) {
+        values.push_back(value(operand));
+    }
+    return "_ret = PyTuple_Pack(" + std::to_string(values.size()) + ", " + joinOperandList(values) +
+           ");\nif (!_ret) goto error;\ngoto done;";
+}
+
+std::string PyExtGenerator::handlePrint(const IRInstruction& instruction) {
+    return "if (_vypr_print(" + value(instruction.operands[0]) + ") < 0) goto error;";
+}
+
+std::string PyExtGenerator::handleInput(const IRInstruction& instruction) {
+    return assign(instruction.operands[0], "_vypr_input()");
+}
+
+std::string PyExtGenerator::handleArrayNew(const IRInstruction& instruction) {
+    std::vector<std::string> elements;
+    if (instruction.operands.size() > 1) {
+        elements = splitOperandList(instruction.operands[1]);
+    }
+
+    std::string code = "_tmp = PyList_New(" + std::to_string(elements.size()) + ");\nif (!_tmp) goto error;";
+    for (size_t i = 0; i < elements.size(); ++i) {
+        std::string element = value(elements[i]);
+        code += "\nPy_INCREF(" + element + "); PyList_SET_ITEM(_tmp, " + std::to_string(i) + ", " + element + ");";
+    }
+    return code + "\nVYPR_SET(" + local(instruction.operands[0]) + ", _tmp);";
+}
+
+std::string PyExtGenerator::handleArrayGet(const IRInstruction& instruction) {
+    if (ranges->inBounds(currentIndex)) {
+        return assign(instruction.operands[0], "_vypr_item(" + value(instruction.operands[1]) + ", " +
+                      value(instruction.operands[2]) + ")");
+    }
+    return assign(instruction.operands[0], "PyObject_GetItem(" + value(instruction.operands[1]) + ", " +
+                  value(instruction.operands[2]) + ")");
+}
+
+std::string PyExtGenerator::handleArraySet(const IRInstruction& instruction) {
+    if (ranges->inBounds(currentIndex)) {
+        return "if (_vypr_set_item(" + value(instruction.operands[0]) + ", " + value(instruction.operands[1]) + ", " +
+               value(instruction.operands[2]) + ") < 0) goto error;";
+    }
+    return "if (PyObject_SetItem(" + value(instruction.operands[0]) + ", " + value(instruction.operands[1]) + ", " +
+           value(instruction.operands[2]) + ") < 0) goto error;";
+}
+
+std::string PyExtGenerator::handleMemberGet(const IRInstruction& instruction) {
+    std::string object = value(instruction.operands[1]);
+    std::string member = instruction.operands[2];
+
+    // Special handling for array length
+    if (member == "length") {
+        return assign(instruction.operands[0], "_vypr_length(" + object + ")");
+    }
+    return assign(instruction.operands[0], "PyObject_GetAttrString(" + object + ", \"" + member + "\")");
+}
+
+std::string PyExtGenerator::handleConvert(const IRInstruction& instruction) {
+    std::string targetType = instruction.operands[1];
+    std::string source = value(instruction.operands[2]);
+
+    // int() of a value that is already an int returns it unchanged
+    IntRange range;
+    if (targetType == "int" && ranges->operandRange(currentIndex, instruction.operands[2], range)) {
+        return "Py_INCREF(" + source + "); VYPR_SET(" + local(instruction.operands[0]) + ", " + source + ");";
+    }
+    if (targetType == "int") return assign(instruction.operands[0], "PyNumber_Long(" + source + ")");
+    if (targetType == "float") return assign(instruction.operands[0], "PyNumber_Float(" + source + ")");
+    if (targetType == "str") return assign(instruction.operands[0], "PyObject_Str(" + source + ")");
+    if (targetType == "bool") return assign(instruction.operands[0], "_vypr_bool(" + source + ")");
+    throw CodeGenError("Unsupported conversion in C code generation: " + targetType);
+}
+
+std::string PyExtGenerator::handleUnpack(const IRInstruction& instruction) {
+    size_t count = instruction.operands.size() - 1;
+    std::string code = "_tmp = PySequence_Fast(" + value(instruction.operands[0]) +
+                       ", \"cannot unpack non-sequence\");\nif (!_tmp) goto error;";
+    code += "\nif (PySequence_Fast_GET_SIZE(_tmp) != " + std::to_string(count) +
+            ") { Py_DECREF(_tmp); PyErr_SetString(PyExc_ValueError, \"expected " + std::to_string(count) +
+            " values to unpack\"); goto error; }";
+    for (size_t i = 0; i < count; ++i) {
+        std::string target = local(instruction.operands[i + 1]);
+        code += "\n{ PyObject* _item = PySequence_Fast_GET_ITEM(_tmp, " + std::to_string(i) +
+                "); Py_INCREF(_item); VYPR_SET(" + target + ", _item); }";
+    }
+    return code + "\nPy_DECREF(_tmp);";
+}
+
+std::string PyExtGenerator::handleLabel(const IRInstruction& instruction) {
+    return "L_" + instruction.operands[0] +":;";
+}
+
+std::string PyExtGenerator::value(const std::string& operand) const {
+    if (isIRName(operand)) {
+        return local(operand);
+    }
+    auto it = constants.find(operand);
+    if (it == constants.end()) {
+        throw CodeGenError("Unknown constant operand in C code generation: " + operand);
+    }
+    return "_vypr_const[" + std::to_string(it->second) + "]";
+}
+
+std::string PyExtGenerator::local(const std::string& name) const {
+    return "v_" + name;
+}
+
+std::string PyExtGenerator::assign(const std::string& target, const std::string& expression) const {
+    return "_tmp = " + expression + ";\nif (!_tmp) goto error;\nVYPR_SET(" + local(target) + ", _tmp);";
+}
+
+std::string PyExtGenerator::cStringLiteral(const std::string& text) const {
+    std::string result = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '\\' && i + 1 < text.size()) {
+            // Keep the escapes C and Python agree on, otherwise the backslash is literal
+            char next = text[i + 1];
+            if (next == 'n' || next == 't' || next == 'r' || next == '\\' || next == '\'' || next == '"' || next == '0') {
+                result += '\\';
+                result += next;
+                ++i;
+            } else {
+                result += "\\\\";
+            }
+        } else if (c == '\\') {
+            result += "\\\\";
+        } else if (c == '"') {
+            result += "\\\"";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else if (c < 0x20 || c >= 0x7f) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\%03o", c);
+            result += buffer;
+        } else {
+            result += static_cast<char>(c);
+        }
+    }
+    return result + "\"";
+}
+
+std::string PyExtGenerator::runCommand(const std::string& command) const {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        return output;
+    }
+    char buffer[256];
+    while (std::fgets(buffer, sizeof(buffer), pipe)) {
+        output += buffer;
+    }
+    pclose(pipe);
+    return output;
+}
+
+} // namespace vypr
@@ -33,7 +33,8 @@ Symbol* Scope::resolve(const std::string& name) {
     return nullptr;
 }
 
-SemanticAnalyzer::SemanticAnalyzer() : current_scope(nullptr), in_function(false) {
+SemanticAnalyzer::SemanticAnalyzer()
+    : current_scope(nullptr), in_function(false), function_return_count(-1), multi_value_call(nullptr) {
     // Start with global scope
     current_scope = new Scope();
 }
@@ -85,6 +86,8 @@ void SemanticAnalyzer::visit(const std::shared_ptr<Program>& node) {
 void SemanticAnalyzer::visit(const StatementPtr& stmt) {
     if (auto varDecl = std::dynamic_pointer_cast<VarDeclarationStatement>(stmt)) {
         visitVarDeclaration(varDecl);
+    } else if (auto destructDecl = std::dynamic_pointer_cast<DestructuringDeclaration>(stmt)) {
+        visitDestructuringDeclaration(destructDecl);
     } else if (auto funcDecl = std::dynamic_pointer_cast<FunctionDeclaration>(stmt)) {
         visitFunctionDeclaration(funcDecl);
     } else if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStatement>(stmt)) {
@@ -149,6 +152,34 @@ void SemanticAnalyzer::visitVarDeclaration(const std::shared_ptr<VarDeclarationS
     current_scope->define(stmt->name, Symbol(Symbol::Type::VARIABLE, stmt->initializer != nullptr));
 }
 
+void SemanticAnalyzer::visitDestructuringDeclaration(const std::shared_ptr<DestructuringDeclaration>& stmt) {
+    // Check the initializer first, the names are not in scope yet
+    auto call = std::dynamic_pointer_cast<CallExpression>(stmt->initializer);
+    multi_value_call = call.get();
+    visit(stmt->initializer);
+    
+    // A call to a function with a fixed number of return values must match
+    if (call) {
+        Symbol* callee = current_scope->resolve(call->callee);
+        if (callee != nullptr && callee->type == Symbol::Type::FUNCTION &&
+            callee->returnCount > 1 && callee->returnCount != static_cast<int>(stmt->names.size())) {
+            std::stringstream ss;
+            ss << "Function '" << call->callee << "' returns " << callee->returnCount
+               << " values, but " << stmt->names.size() << " variables are declared";
+            throw SemanticError(ss.str());
+        }
+    }
+    
+    for (const auto& name : stmt->names) {
+        if (current_scope->isDefined(name)) {
+            std::stringstream ss;
+            ss << "Variable '" << name << "' is already defined in this scope";
+            throw SemanticError(ss.str());
+        }
+        current_scope->define(name, Symbol(Symbol::Type::VARIABLE, true));
+    }
+}
+
 void SemanticAnalyzer::visitFunctionDeclaration(const std::shared_ptr<FunctionDeclaration>& stmt) {
     // Check if function is already defined in current scope
     if (current_scope->isDefined(stmt->name)) {
@@ -165,7 +196,9 @@ void SemanticAnalyzer::visitFunctionDeclaration(const std::shared_ptr<FunctionDe
     
     // Set in_function flag
     bool previous_in_function = in_function;
+    int previous_return_count = function_return_count;
     in_function = true;
+    function_return_count = -1;
     
     // Add parameters to the function scope
     for (const auto& param : stmt->parameters) {
@@ -180,14 +213,22 @@ void SemanticAnalyzer::visitFunctionDeclaration(const std::shared_ptr<FunctionDe
     // Visit function body
     visit(stmt->body);
     
+    int return_count = function_return_count;
+    
     // Restore in_function flag
     in_function = previous_in_function;
+    function_return_count = previous_return_count;
     
     // Exit function scope
     exitScope();
+    
+    // Record how many values the function returns for destructuring checks
+    current_scope->resolve(stmt->name)->returnCount = return_count;
 }
 
 void SemanticAnalyzer::visitExpressionStatement(const std::shared_ptr<ExpressionStatement>& stmt) {
+    // The values of a call made for its effects are dropped, however many
+    multi_value_call = std::dynamic_pointer_cast<CallExpression>(stmt->expression).get();
     visit(stmt->expression);
 }
 
@@ -224,9 +265,28 @@ void SemanticAnalyzer::visitReturnStatement(const std::shared_ptr<ReturnStatemen
         throw SemanticError("Cannot return from outside a function");
     }
     
-    // Check return value if it exists
-    if (stmt->value != nullptr) {
-        visit(stmt->value);
+    // All value-returning statements of a function must agree on the count.
+    // `return f()` passes on every value f returns.
+    int count = static_cast<int>(stmt->values.size());
+    auto call = count == 1 ? std::dynamic_pointer_cast<CallExpression>(stmt->values[0]) : nullptr;
+    Symbol* callee = call ? current_scope->resolve(call->callee) : nullptr;
+    if (callee != nullptr && callee->type == Symbol::Type::FUNCTION && callee->returnCount > 1) {
+        count = callee->returnCount;
+        multi_value_call = call.get();
+    }
+    if (count > 0) {
+        if (function_return_count != -1 && function_return_count != count) {
+            std::stringstream ss;
+            ss << "Function returns " << count << " values here but "
+               << function_return_count << " elsewhere";
+            throw SemanticError(ss.str());
+        }
+        function_return_count = count;
+    }
+    
+    // Check return values if they exist
+    for (const auto& value : stmt->values) {
+        visit(value);
     }
 }
 
@@ -372,7 +432,17 @@ void SemanticAnalyzer::visitCallExpression(const std::shared_ptr<CallExpression>
                << " arguments, but got " << expr->arguments.size();
             throw SemanticError(ss.str());
         }
+        
+        // Several return values only fit a destructuring declaration, a
+        // return or a call statement
+        if (symbol->returnCount > 1 && expr.get() != multi_value_call) {
+            std::stringstream ss;
+            ss << "Function '" << callee_name << "' returns " << symbol->returnCount
+               << " values, but is used as a single value";
+            throw SemanticError(ss.str());
+        }
     }
+    multi_value_call = nullptr;
     
     // Check arguments (for both built-in and user-defined)
     for (const auto& arg : expr->arguments) {
@@ -0,0 +1,79 @@
+#include "type_profile.h"
+#include "exceptions.h"
+#include <fstream>
+#include <sstream>
+
+namespace vypr {
+
+std::uint64_t SiteProfile::total() const {
+    std::uint64_t sum = 0;
+    for (const auto& [signature, count] : types) {
+        sum += count;
+    }
+    return sum;
+}
+
+std::vector<std::string> SiteProfile::dominant(double share) const {
+    std::uint64_t sum = total();
+    for (const auto& [signature, count] : types) {
+        if (sum > 0 && static_cast<double>(count) >= share * static_cast<double>(sum)) {
+            std::vector<std::string> result;
+            std::stringstream parts(signature);
+            std::string type;
+            while (std::getline(parts, type, ',')) {
+                result.push_back(type);
+            }
+            return result;
+        }
+    }
+    return {};
+}
+
+std::string TypeProfile::siteId(const std::string& function, size_t index) {
+    return function + ":" + std::to_string(index);
+}
+
+void TypeProfile::load(const std::string& file) {
+    std::ifstream in(file);
+    if (!in.is_open()) {
+        throw CompileError("Could not open type profile: " + file);
+    }
+
+    // One tab-separated record per site and signature:
+    // <site> <operator or callee> <comma-separated types> <count>
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::stringstream parts(line);
+        std::string field;
+        while (std::getline(parts, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 4 || fields[3].empty() ||
+            fields[3].find_first_not_of("0123456789") != std::string::npos) {
+            throw CompileError("Malformed type profile " + file + " at line " + std::to_string(lineNumber));
+        }
+
+        SiteProfile& site = sites[fields[0]];
+        if (!site.what.empty() && site.what != fields[1]) {
+            throw CompileError("Conflicting records for site " + fields[0] + " in type profile " + file);
+        }
+        site.what = fields[1];
+        site.types[fields[2]] += std::stoull(fields[3]);
+    }
+}
+
+const SiteProfile* TypeProfile::find(const std::string& site, const std::string& what) const {
+    auto it = sites.find(site);
+    if (it == sites.end() || it->second.what != what) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+} // namespace vypr
@@ -0,0 +1,559 @@
+#include "value_range.h"
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <unordered_map>
+
+namespace vypr {
+
+// Lists hold at most PY_SSIZE_T_MAX / sizeof(PyObject*) items, and strings
+// are bounded by the address space long before 2^62 characters
+static const long long kMaxLength = 1LL << 62;
+
+// Rounds over all blocks after widening, each one tightening the loop heads
+static const int kNarrowingRounds = 2;
+
+std::string IntRange::toString() const {
+    std::string low = lo == kMinusInfinity ? "-inf" : std::to_string(lo);
+    std::string high = hi == kPlusInfinity ? "+inf" : std::to_string(hi);
+    return "[" + low + ", " + high + "]";
+}
+
+static bool isInfinite(long long bound) {
+    return bound == IntRange::kMinusInfinity || bound == IntRange::kPlusInfinity;
+}
+
+// a + b for one bound; infinite operands and overflow give `infinity`,
+// which only ever loosens the range
+static long long addBound(long long a, long long b, long long infinity) {
+    if (isInfinite(a) || isInfinite(b) || (b > 0 && a > LLONG_MAX - 1 - b) || (b < 0 && a < LLONG_MIN + 1 - b)) {
+        return infinity;
+    }
+    return a + b;
+}
+
+static long long negateBound(long long a) {
+    if (a == IntRange::kMinusInfinity) return IntRange::kPlusInfinity;
+    if (a == IntRange::kPlusInfinity) return IntRange::kMinusInfinity;
+    return -a;
+}
+
+static IntRange add(const IntRange& a, const IntRange& b) {
+    return {addBound(a.lo, b.lo, IntRange::kMinusInfinity), addBound(a.hi, b.hi, IntRange::kPlusInfinity)};
+}
+
+static IntRange negate(const IntRange& a) {
+    return {negateBound(a.hi), negateBound(a.lo)};
+}
+
+static IntRange multiply(const IntRange& a, const IntRange& b) {
+    if (!a.isFinite() || !b.isFinite()) {
+        return {};
+    }
+    long long products[4];
+    const long long left[4] = {a.lo, a.lo, a.hi, a.hi};
+    const long long right[4] = {b.lo, b.hi, b.lo, b.hi};
+    for (int k = 0; k < 4; ++k) {
+        long long x = left[k], y = right[k];
+        if (x != 0 && y != 0 && (x > (LLONG_MAX - 1) / (y < 0 ? -y : y) || x < -(LLONG_MAX - 1) / (y < 0 ? -y : y))) {
+            return {};
+        }
+        products[k] = x * y;
+    }
+    return {*std::min_element(products, products + 4), *std::max_element(products, products + 4)};
+}
+
+// Python's % takes the sign of the divisor
+static IntRange modulo(const IntRange& b) {
+    if (b.lo > 0 && b.hi != IntRange::kPlusInfinity) {
+        return {0, b.hi - 1};
+    }
+    if (b.hi < 0 && b.lo != IntRange::kMinusInfinity) {
+        return {b.lo + 1, 0};
+    }
+    return {};
+}
+
+static IntRange hull(const IntRange& a, const IntRange& b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    return {std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+}
+
+// Bounds that are still moving jump to infinity so loops converge
+static IntRange widen(const IntRange& before, const IntRange& after) {
+    if (before.empty()) return after;
+    if (after.empty()) return before;
+    return {after.lo < before.lo ? IntRange::kMinusInfinity : before.lo,
+            after.hi > before.hi ? IntRange::kPlusInfinity : before.hi};
+}
+
+// Integer literal operand, such as "42" or "-7"
+static bool intLiteral(const std::string& operand, long long& value) {
+    size_t start = !operand.empty() && operand[0] == '-' ? 1 : 0;
+    if (operand.size() <= start || operand.size() - start > 18) {
+        return false;
+    }
+    for (size_t k = start; k < operand.size(); ++k) {
+        if (!std::isdigit(static_cast<unsigned char>(operand[k]))) {
+            return false;
+        }
+    }
+    value = std::stoll(operand);
+    return true;
+}
+
+ValueRangeAnalysis::ValueRangeAnalysis(const ControlFlowGraph& cfg) : cfg(cfg) {
+    const auto& code = cfg.function().instructions;
+    const auto& blocks = cfg.blocks();
+    const NameTable& names = cfg.names();
+    reads.assign(code.size(), {});
+    results.assign(code.size(), {false, IntRange()});
+    checked.assign(code.size(), false);
+    if (code.empty()) {
+        return;
+    }
+
+    // Only names seen in more than one block (or in a block looping to
+    // itself) are kept in the block states
+    const size_t none = static_cast<size_t>(-1);
+    std::vector<size_t> firstBlock(names.size(), none);
+    std::vector<bool> crossing(names.size(), false);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const auto& successors = blocks[b].successors;
+        bool selfLoop = std::find(successors.begin(), successors.end(), b) != successors.end();
+        auto note = [&](size_t name) {
+            if (firstBlock[name] == none) {
+                firstBlock[name] = b;
+            }
+            crossing[name] = crossing[name] || selfLoop || firstBlock[name] != b;
+        };
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            for (size_t name : cfg.uses(i)) note(name);
+            for (size_t name : cfg.defs(i)) note(name);
+        }
+    }
+
+    auto nameId = [&](const std::string& operand) { return isIRName(operand) ? names.find(operand) : -1; };
+
+    // Variables whose length may bound an index; only redefining one of
+    // these can end a "below its length" fact
+    std::vector<bool> lengthObject(names.size(), false);
+    std::vector<bool> measured(names.size(), false);
+    for (const auto& instr : code) {
+        long object = instr.opcode == IROpCode::MEMBER_GET && instr.operands[2] == "length" ? nameId(instr.operands[1]) : -1;
+        if (object >= 0) {
+            lengthObject[static_cast<size_t>(object)] = true;
+        }
+    }
+    for (const auto& instr : code) {
+        long temp = instr.opcode == IROpCode::LOAD_VAR ? nameId(instr.operands[0]) : -1;
+        long variable = temp >= 0 ? nameId(instr.operands[1]) : -1;
+        if (variable >= 0 && lengthObject[static_cast<size_t>(temp)]) {
+            measured[static_cast<size_t>(variable)] = true;
+        }
+    }
+
+    // Runs block b from `in`, producing the state on each successor edge.
+    // Comparisons, copies and lengths are remembered within the block so a
+    // branch can narrow the variables its condition was loaded from.
+    auto run = [&](size_t b, const State& in, bool record) {
+        transfers++;
+        std::unordered_map<size_t, Fact> facts(in.begin(), in.end());
+        std::unordered_map<size_t, std::vector<size_t>> holders;  // Variable -> names whose fact may be below it
+        for (const auto& [name, fact] : in) {
+            if (fact.below >= 0) {
+                holders[static_cast<size_t>(fact.below)].push_back(name);
+            }
+        }
+        std::unordered_map<size_t, size_t> version;                    // Name -> definitions seen in this block
+        std::unordered_map<size_t, std::pair<size_t, size_t>> copyOf;  // Temp -> (variable, version) it was loaded from
+        std::unordered_map<size_t, std::pair<size_t, size_t>> lengthOf;  // Temp -> (variable, version) whose length it is
+        struct Comparison {
+            size_t instruction;
+            size_t leftVersion, rightVersion;  // Of the operands, so later changes to them are noticed
+        };
+        std::unordered_map<size_t, Comparison> comparison;  // Temp -> BINARY_OP that compared into it
+        auto versionOf = [&](const std::string& operand) {
+            long id = nameId(operand);
+            return id >= 0 ? version[static_cast<size_t>(id)] : 0;
+        };
+
+        auto factOf = [&](const std::string& operand, Fact& fact) {
+            long long literal;
+            if (intLiteral(operand, literal)) {
+                fact = {IntRange::point(literal), -1};
+                return true;
+            }
+            long id = nameId(operand);
+            auto it = id >= 0 ? facts.find(static_cast<size_t>(id)) : facts.end();
+            if (it == facts.end()) {
+                return false;
+            }
+            fact = it->second;
+            return true;
+        };
+        auto current = [&](const std::unordered_map<size_t, std::pair<size_t, size_t>>& links, long temp, long& variable) {
+            auto it = temp >= 0 ? links.find(static_cast<size_t>(temp)) : links.end();
+            if (it == links.end() || version[it->second.first] != it->second.second) {
+                return false;
+            }
+            variable = static_cast<long>(it->second.first);
+            return true;
+        };
+
+        const BasicBlock& block = blocks[b];
+        for (size_t i = block.begin; i < block.end; ++i) {
+            const auto& ops = code[i].operands;
+            if (record) {
+                for (size_t name : cfg.uses(i)) {
+                    auto it = facts.find(name);
+                    if (it != facts.end()) {
+                        reads[i].push_back({name, it->second.range});
+                    }
+                }
+            }
+
+            Fact result;
+            bool isInt = false;
+            switch (code[i].opcode) {
+                case IROpCode::LOAD_CONST: {
+                    long long literal;
+                    if (intLiteral(ops[1], literal)) {
+                        result = {IntRange::point(literal), -1};
+                        isInt = true;
+                    }
+                    break;
+                }
+                case IROpCode::LOAD_VAR:
+                case IROpCode::STORE_VAR:
+                    isInt = factOf(ops[1], result);
+                    break;
+                case IROpCode::BINARY_OP: {
+                    Fact left, right;
+                    const std::string& op = ops[2];
+                    if (op == "<" || op == "<=" || op == ">" || op == ">=" || op == "==" || op == "!=") {
+                        break;
+                    }
+                    if (!factOf(ops[1], left) || !factOf(ops[3], right)) {
+                        break;
+                    }
+                    isInt = op == "+" || op == "-" || op == "*" || op == "%";
+                    if (op == "+") result.range = add(left.range, right.range);
+                    if (op == "-") result.range = add(left.range, negate(right.range));
+                    if (op == "*") result.range = multiply(left.range, right.range);
+                    if (op == "%") result.range = modulo(right.range);
+                    break;
+                }
+                case IROpCode::UNARY_OP:
+                    if (ops[1] == "-" && factOf(ops[2], result)) {
+                        result = {negate(result.range), -1};
+                        isInt = true;
+                    }
+                    break;
+                case IROpCode::CONVERT:
+                    // int() of an int is the same int; of anything else some int
+                    if (ops[1] == "int") {
+                        isInt = true;
+                        if (!factOf(ops[2], result)) {
+                            result = Fact();
+                        }
+                    }
+                    break;
+                case IROpCode::MEMBER_GET:
+                    if (ops[2] == "length") {
+                        result = {{0, kMaxLength}, -1};
+                        isInt = true;
+                    }
+                    break;
+                case IROpCode::ARRAY_GET:
+                case IROpCode::ARRAY_SET: {
+                    bool get = code[i].opcode == IROpCode::ARRAY_GET;
+                    Fact index;
+                    long array;
+                    if (record && factOf(ops[get ? 2 : 1], index) && index.range.lo >= 0 && index.below >= 0 &&
+                        current(copyOf, nameId(ops[get ? 1 : 0]), array) && array == index.below) {
+                        checked[i] = true;
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            for (size_t name : cfg.defs(i)) {
+                // Redefining a variable ends every "below its length" fact
+                ++version[name];
+                auto held = measured[name] ? holders.find(name) : holders.end();
+                if (held != holders.end()) {
+                    for (size_t holder : held->second) {
+                        auto it = facts.find(holder);
+                        if (it != facts.end() && it->second.below == static_cast<long>(name)) {
+                            it->second.below = -1;
+                        }
+                    }
+                    holders.erase(held);
+                }
+                if (isInt && !result.range.empty()) {
+                    facts[name] = result;
+                    if (result.below >= 0) {
+                        holders[static_cast<size_t>(result.below)].push_back(name);
+                    }
+                } else {
+                    facts.erase(name);
+                }
+                if (record) {
+                    results[i] = {isInt, result.range};
+                }
+
+                copyOf.erase(name);
+                lengthOf.erase(name);
+                comparison.erase(name);
+                long source;
+                if (code[i].opcode == IROpCode::LOAD_VAR && (source = nameId(ops[1])) >= 0) {
+                    copyOf[name] = {static_cast<size_t>(source), version[static_cast<size_t>(source)]};
+                } else if (code[i].opcode == IROpCode::MEMBER_GET && ops[2] == "length" &&
+                           current(copyOf, nameId(ops[1]), source)) {
+                    lengthOf[name] = {static_cast<size_t>(source), version[static_cast<size_t>(source)]};
+                } else if (code[i].opcode == IROpCode::BINARY_OP) {
+                    comparison[name] = {i, versionOf(ops[1]), versionOf(ops[3])};
+                }
+            }
+        }
+
+        // A conditional jump narrows the compared names on each edge:
+        // successors[0] is its target, the other one the fallthrough
+        const IRInstruction& last = code[block.end - 1];
+        std::vector<State> outs;
+        for (size_t s = 0; s < block.successors.size(); ++s) {
+            std::unordered_map<size_t, Fact> edge;
+            bool conditional = (last.opcode == IROpCode::JUMP_IF_FALSE || last.opcode == IROpCode::JUMP_IF_TRUE) &&
+                               block.successors.size() == 2;
+            long condition = conditional ? nameId(last.operands[0]) : -1;
+            auto compared = condition >= 0 ? comparison.find(static_cast<size_t>(condition)) : comparison.end();
+            const auto* cmpInstr = compared != comparison.end() ? &code[compared->second.instruction] : nullptr;
+            if (cmpInstr && versionOf(cmpInstr->operands[1]) == compared->second.leftVersion &&
+                versionOf(cmpInstr->operands[3]) == compared->second.rightVersion) {
+                const auto& cmp = cmpInstr->operands;
+                bool taken = s == 0;
+                bool holds = (last.opcode == IROpCode::JUMP_IF_TRUE) == taken;
+
+                // Normalize to x < y, x <= y or x == y
+                std::string x = cmp[1], op = cmp[2], y = cmp[3];
+                if (!holds) {
+                    static const std::unordered_map<std::string, std::string> negated = {
+                        {"<", ">="}, {"<=", ">"}, {">", "<="}, {">=", "<"}, {"==", "!="}, {"!=", "=="}};
+                    auto it = negated.find(op);
+                    op = it == negated.end() ? "" : it->second;
+                }
+                if (op == ">" || op == ">=") {
+                    std::swap(x, y);
+                    op = op == ">" ? "<" : "<=";
+                }
+
+                Fact fx, fy;
+                bool hasX = factOf(x, fx), hasY = factOf(y, fy);
+                bool changedX = false, changedY = false;
+                if (op == "<" || op == "<=") {
+                    long long gap = op == "<" ? 1 : 0;
+                    if (hasX && hasY) {
+                        fx.range.hi = std::min(fx.range.hi, addBound(fy.range.hi, -gap, IntRange::kPlusInfinity));
+                        fy.range.lo = std::max(fy.range.lo, addBound(fx.range.lo, gap, IntRange::kMinusInfinity));
+                        changedX = changedY = true;
+                    }
+                    long array;
+                    if (hasX && op == "<" && current(lengthOf, nameId(y), array)) {
+                        fx.below = array;
+                        changedX = true;
+                    }
+                } else if (op == "==" && hasX && hasY) {
+                    fx.range = fy.range = {std::max(fx.range.lo, fy.range.lo), std::min(fx.range.hi, fy.range.hi)};
+                    changedX = changedY = true;
+                }
+
+                // The facts hold for the compared temps and for the variables
+                // they are still copies of
+                auto narrow = [&](const std::string& operand, const Fact& fact) {
+                    long id = nameId(operand);
+                    if (id < 0) {
+                        return;
+                    }
+                    edge[static_cast<size_t>(id)] = fact;
+                    long variable;
+                    if (current(copyOf, id, variable)) {
+                        Fact narrowed = fact;
+                        auto known = facts.find(static_cast<size_t>(variable));
+                        if (known != facts.end() && narrowed.below < 0) {
+                            narrowed.below = known->second.below;
+                        }
+                        edge[static_cast<size_t>(variable)] = narrowed;
+                    }
+                };
+                if (changedX) narrow(x, fx);
+                if (changedY) narrow(y, fy);
+            }
+
+            State out;
+            for (const auto& [name, fact] : facts) {
+                if (crossing[name]) {
+                    auto narrowed = edge.find(name);
+                    out.push_back({name, narrowed == edge.end() ? fact : narrowed->second});
+                }
+            }
+            for (const auto& [name, fact] : edge) {
+                if (crossing[name] && !facts.count(name)) {
+                    out.push_back({name, fact});
+                }
+            }
+            std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            outs.push_back(std::move(out));
+        }
+        return outs;
+    };
+
+    // Facts both states agree on; with `widening`, bounds that grew since
+    // `before` go to infinity
+    auto join = [](const State& a, const State& b, bool widening) {
+        State joined;
+        size_t j = 0;
+        for (const auto& [name, fact] : a) {
+            while (j < b.size() && b[j].first < name) {
+                j++;
+            }
+            if (j == b.size() || b[j].first != name) {
+                continue;
+            }
+            const Fact& other = b[j].second;
+            Fact merged;
+            merged.range = widening ? widen(fact.range, other.range) : hull(fact.range, other.range);
+            merged.below = fact.below == other.below ? fact.below : -1;
+            joined.push_back({name, merged});
+        }
+        return joined;
+    };
+
+    const auto& order = cfg.reversePostorder();
+    std::vector<size_t> position(blocks.size(), none);
+    for (size_t k = 0; k < order.size(); ++k) {
+        position[order[k]] = k;
+    }
+    // Blocks entered by a back edge are where loops are widened
+    std::vector<bool> loopHead(blocks.size(), false);
+    for (size_t b : order) {
+        for (size_t p : blocks[b].predecessors) {
+            loopHead[b] = loopHead[b] || (position[p] != none && position[p] >= position[b]);
+        }
+    }
+
+    std::vector<State> in(blocks.size());
+    std::vector<bool> reached(blocks.size(), false);
+    std::vector<std::vector<State>> out(blocks.size());
+    auto incoming = [&](size_t b, bool& any) {
+        State state;
+        any = b == order[0];
+        for (size_t p : blocks[b].predecessors) {
+            if (!reached[p]) {
+                continue;
+            }
+            const auto& successors = blocks[p].successors;
+            for (size_t s = 0; s < successors.size(); ++s) {
+                if (successors[s] == b) {
+                    state = any ? join(state, out[p][s], false) : out[p][s];
+                    any = true;
+                }
+            }
+        }
+        return state;
+    };
+
+    // Ascending phase with widening at loop heads. Widening bounds every
+    // fact's changes, the cap on visits only guards against surprises.
+    std::set<size_t> worklist;
+    for (size_t k = 0; k < order.size(); ++k) {
+        worklist.insert(k);
+    }
+    size_t limit = 64 * blocks.size() + 64;
+    while (!worklist.empty()) {
+        size_t b = order[*worklist.begin()];
+        worklist.erase(worklist.begin());
+        bool any;
+        State state = incoming(b, any);
+        if (!any) {
+            continue;
+        }
+        if (reached[b] && loopHead[b]) {
+            state = join(in[b], state, true);
+        }
+        if (reached[b] && state == in[b]) {
+            continue;
+        }
+        if (transfers >= limit) {
+            // Give up on ranges rather than risk a wrong one
+            std::fill(reached.begin(), reached.end(), false);
+            return;
+        }
+        in[b] = std::move(state);
+        reached[b] = true;
+        std::vector<State> next = run(b, in[b], false);
+        for (size_t s = 0; s < next.size(); ++s) {
+            if (out[b].size() != next.size() || out[b][s] != next[s]) {
+                worklist.insert(position[blocks[b].successors[s]]);
+            }
+        }
+        out[b] = std::move(next);
+    }
+
+    // Descending phase: plain passes from the widened solution only tighten
+    // it. Without loops nothing was widened and the solution is final.
+    bool widened = std::find(loopHead.begin(), loopHead.end(), true) != loopHead.end();
+    for (int round = 0; widened && round < kNarrowingRounds; ++round) {
+        for (size_t b : order) {
+            bool any;
+            State state = incoming(b, any);
+            if (!any || !reached[b]) {
+                continue;
+            }
+            in[b] = std::move(state);
+            out[b] = run(b, in[b], false);
+        }
+    }
+
+    for (size_t b : order) {
+        if (reached[b]) {
+            run(b, in[b], true);
+        }
+    }
+}
+
+bool ValueRangeAnalysis::operandRange(size_t index, const std::string& operand, IntRange& range) const {
+    long long literal;
+    if (intLiteral(operand, literal)) {
+        range = IntRange::point(literal);
+        return true;
+    }
+    long id = cfg.names().find(operand);
+    if (id < 0 || index >= reads.size()) {
+        return false;
+    }
+    for (const auto& [name, known] : reads[index]) {
+        if (name == static_cast<size_t>(id)) {
+            range = known;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ValueRangeAnalysis::resultRange(size_t index, IntRange& range) const {
+    if (index >= results.size() || !results[index].first) {
+        return false;
+    }
+    range = results[index].second;
+    return true;
+}
+
+bool ValueRangeAnalysis::inBounds(size_t index) const {
+    return index < checked.size() && checked[index];
+}
+
+} // namespace vypr
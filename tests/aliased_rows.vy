@@ -0,0 +1,14 @@
+// Both rows of m are the same list, so m[0][i] and m[1][i] are one element.
+// Interchanging the loops changes which writes each read sees; the program
+// must print 3 and 7 with and without the optimizer.
+var row = [1, 1]
+var m = [row, row]
+var i = 0
+while i < 2:
+    var j = 0
+    while j < 2:
+        m[j][i] = m[j][0] + m[j][1]
+        j = j + 1
+    i = i + 1
+print m[0][0]
+print m[0][1]
@@ -0,0 +1,17 @@
+// m[2] is m itself, so the store m[2][i] replaces the row m[i] and the
+// stores m[j][i] then write into fill. Interchanging the loops changes which
+// rows are replaced before they are written; the program must print p and
+// q!! with and without the optimizer.
+var fill = ["p", "q"]
+var m = [["a", "b"], ["c", "d"], ["e", "f"]]
+m[2] = m
+var i = 0
+while i < 2:
+    var j = 0
+    while j < 2:
+        m[j][i] = m[j][i] + "!"
+        m[2][i] = fill
+        j = j + 1
+    i = i + 1
+print fill[0]
+print fill[1]
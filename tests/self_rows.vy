@@ -0,0 +1,14 @@
+// m[0] is m itself, so the store m[0][1] replaces the row m[1]. The lookup
+// m[1] must not be hoisted out of the loop; the program must print 50 with
+// and without the optimizer.
+var inner = [10]
+var m = [inner, [20]]
+m[0] = m
+var s = 0
+var k = 0
+while k < 2:
+    var r = m[1][0]
+    m[0][1] = [30]
+    s = s + r
+    k = k + 1
+print s